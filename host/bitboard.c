@@ -0,0 +1,160 @@
+// bitmask move tests for PUZZ pieces: see bitboard.h
+
+#include "bitboard.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint64_t BbVec __attribute__((vector_size(8 * BB_LANES)));
+
+#define BIT(cell) ((uint64_t)1 << ((cell) & 63))
+#define WORD(cell) ((cell) >> 6)
+
+static const int8_t opposite[5] = { NONE, RIGHT, DOWN, LEFT, UP };
+
+// word w of mask m moved one square in direction: towards bit 0 for LEFT and UP, away from it for RIGHT and DOWN.
+// a square is 1 bit across or across bits down, always less than 64
+static inline uint64_t shift_word(const uint64_t * m, int stride, int w, int words, int direction, int across) {
+    int s;
+    s = direction == LEFT || direction == RIGHT ? 1 : across;
+    if (direction == LEFT || direction == UP) {
+        return m[w * stride] >> s | (w + 1 < words ? m[(w + 1) * stride] << (64 - s) : 0);
+    }
+    return m[w * stride] << s | (w ? m[(w - 1) * stride] >> (64 - s) : 0);
+}
+
+static inline void shift_vec(BbVec * out, const uint64_t * m, int stride, int w, int words, int direction, int across) {
+    int s;
+    s = direction == LEFT || direction == RIGHT ? 1 : across;
+    if (direction == LEFT || direction == UP) {
+        *out = *(const BbVec *)(m + w * stride) >> s;
+        if (w + 1 < words) *out |= *(const BbVec *)(m + (w + 1) * stride) << (64 - s);
+    } else {
+        *out = *(const BbVec *)(m + w * stride) << s;
+        if (w) *out |= *(const BbVec *)(m + (w - 1) * stride) >> (64 - s);
+    }
+}
+
+bool bb_init(struct Bitboard * bb, const struct Board * b) {
+    int cell, row, col;
+    void * mask;
+    uint8_t piece;
+    memset(bb, 0, sizeof(*bb));
+    bb->across = b->across;
+    bb->down = b->down;
+    bb->slide = b->slide;
+    bb->words = (b->across * b->down + 63) / 64;
+    memset(bb->index, 0xFF, sizeof(bb->index));
+    for (cell = 0; cell < b->across * b->down; cell++) {
+        piece = b->cell[cell];
+        if (piece && piece != WALL && bb->index[piece] == 0xFF) {
+            bb->index[piece] = bb->num_pieces;
+            bb->id[bb->num_pieces++] = piece;
+        }
+        row = cell / b->across;
+        col = cell % b->across;
+        if (!col) bb->edge[LEFT - LEFT][WORD(cell)] |= BIT(cell);
+        if (!row) bb->edge[UP - LEFT][WORD(cell)] |= BIT(cell);
+        if (col == b->across - 1) bb->edge[RIGHT - LEFT][WORD(cell)] |= BIT(cell);
+        if (row == b->down - 1) bb->edge[DOWN - LEFT][WORD(cell)] |= BIT(cell);
+    }
+    bb->stride = (bb->num_pieces + BB_LANES - 1) / BB_LANES * BB_LANES;
+    if (!bb->stride) bb->stride = BB_LANES;
+    if (posix_memalign(&mask, sizeof(BbVec), bb->words * bb->stride * sizeof(uint64_t))) return false;
+    bb->mask = mask;
+    bb_load(bb, b);
+    return true;
+}
+
+void bb_free(struct Bitboard * bb) {
+    free(bb->mask);
+    bb->mask = NULL;
+}
+
+void bb_load(struct Bitboard * bb, const struct Board * b) {
+    int cell;
+    uint8_t piece;
+    memset(bb->mask, 0, bb->words * bb->stride * sizeof(uint64_t));
+    memset(bb->walls, 0, sizeof(bb->walls));
+    memset(bb->occupied, 0, sizeof(bb->occupied));
+    for (cell = 0; cell < bb->across * bb->down; cell++) {
+        piece = b->cell[cell];
+        if (!piece) continue;
+        bb->occupied[WORD(cell)] |= BIT(cell);
+        if (piece == WALL) {
+            bb->walls[WORD(cell)] |= BIT(cell);
+        } else {
+            bb->mask[WORD(cell) * bb->stride + bb->index[piece]] |= BIT(cell);
+        }
+    }
+}
+
+void bb_store(const struct Bitboard * bb, struct Board * b) {
+    int cell, i;
+    b->across = bb->across;
+    b->down = bb->down;
+    b->slide = bb->slide;
+    for (cell = 0; cell < bb->across * bb->down; cell++) {
+        b->cell[cell] = bb->walls[WORD(cell)] & BIT(cell) ? WALL : 0;
+        for (i = 0; i < bb->num_pieces; i++) {
+            if (bb->mask[WORD(cell) * bb->stride + i] & BIT(cell)) b->cell[cell] = bb->id[i];
+        }
+    }
+}
+
+bool bb_can_move(const struct Bitboard * bb, int i, int direction) {
+    const uint64_t * m;
+    uint64_t blocked;
+    int w;
+    if (direction < LEFT || direction > DOWN) return false;
+    m = bb->mask + i;
+    for (blocked = 0, w = 0; w < bb->words; w++) {
+        blocked |= (shift_word(m, bb->stride, w, bb->words, direction, bb->across) & ~m[w * bb->stride]
+            & bb->occupied[w]) | (m[w * bb->stride] & bb->edge[direction - LEFT][w]);
+    }
+    return !blocked;
+}
+
+void bb_movable(const struct Bitboard * bb, int direction, uint8_t * movable) {
+    BbVec blocked, p, moved;
+    int i, w, lane;
+    if (direction < LEFT || direction > DOWN) {
+        memset(movable, 0, bb->num_pieces);
+        return;
+    }
+    for (i = 0; i < bb->num_pieces; i += BB_LANES) {
+        blocked = (BbVec){ 0 };
+        for (w = 0; w < bb->words; w++) {
+            p = *(const BbVec *)(bb->mask + w * bb->stride + i);
+            shift_vec(&moved, bb->mask + i, bb->stride, w, bb->words, direction, bb->across);
+            blocked |= (moved & ~p & bb->occupied[w]) | (p & bb->edge[direction - LEFT][w]);
+        }
+        for (lane = 0; lane < BB_LANES && i + lane < bb->num_pieces; lane++) movable[i + lane] = !blocked[lane];
+    }
+}
+
+void bb_move_one(struct Bitboard * bb, int i, int direction) {
+    uint64_t moved[BB_MAX_WORDS];
+    uint64_t * m;
+    int w;
+    m = bb->mask + i;
+    for (w = 0; w < bb->words; w++) moved[w] = shift_word(m, bb->stride, w, bb->words, direction, bb->across);
+    for (w = 0; w < bb->words; w++) {
+        bb->occupied[w] = (bb->occupied[w] & ~m[w * bb->stride]) | moved[w];
+        m[w * bb->stride] = moved[w];
+    }
+}
+
+int bb_click(struct Bitboard * bb, int i, int direction) {
+    int squares;
+    if (!bb_can_move(bb, i, direction)) return 0;
+    squares = 0;
+    do {
+        bb_move_one(bb, i, direction);
+        squares++;
+    } while (bb->slide && bb_can_move(bb, i, direction));
+    return squares;
+}
+
+void bb_move_back(struct Bitboard * bb, int i, int direction, int squares) {
+    while (squares--) bb_move_one(bb, i, opposite[direction]);
+}
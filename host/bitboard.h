@@ -0,0 +1,36 @@
+#ifndef _BITBOARD_
+    // pieces as bitmasks over the grid (bit row * across + col), so that a move is tested with a shift and an AND
+    // rather than can_move()'s walk over every cell. Boards of up to 64 squares (8x8) take one 64-bit word per
+    // piece, bigger ones up to BB_MAX_WORDS. Masks are stored word by word across the pieces, so bb_movable()
+    // tests BB_LANES pieces at a time with the compiler's vector extensions (SSE2, AVX2 or NEON as built)
+    #include "rules.h"
+
+    #define BB_MAX_WORDS ((MAX_DOWN * MAX_ACROSS + 63) / 64)
+    #define BB_LANES 4
+
+    struct Bitboard {
+        uint8_t across, down, slide, words;
+        int num_pieces, stride; // stride: num_pieces rounded up to BB_LANES
+        uint8_t id[MAX_PIECES]; // piece number of each index
+        uint8_t index[256]; // index of each piece number, 0xFF if it isn't on the board
+        uint64_t walls[BB_MAX_WORDS];
+        uint64_t occupied[BB_MAX_WORDS]; // pieces and walls
+        uint64_t edge[4][BB_MAX_WORDS]; // by direction - LEFT: the squares a piece can't move on from
+        uint64_t * mask; // word w of piece index i is mask[w * stride + i]
+    };
+
+    bool bb_init(struct Bitboard * bb, const struct Board * b); // false if out of memory
+    void bb_free(struct Bitboard * bb);
+    void bb_load(struct Bitboard * bb, const struct Board * b); // same size and pieces as bb_init()
+    void bb_store(const struct Bitboard * bb, struct Board * b);
+    bool bb_can_move(const struct Bitboard * bb, int i, int direction); // can_move() for piece index i
+    void bb_movable(const struct Bitboard * bb, int direction, uint8_t * movable); // bb_can_move() for every index
+    void bb_move_one(struct Bitboard * bb, int i, int direction); // move_one_piece()
+    // click() for LEFT to DOWN, sliding on as the slide setting says. Returns the squares moved, 0 if it isn't
+    // a move; bb_move_back() undoes it. PUSH isn't done here: slide_pieces() can move any number of pieces, so
+    // use it on a bb_store()d Board and bb_load() the result
+    int bb_click(struct Bitboard * bb, int i, int direction);
+    void bb_move_back(struct Bitboard * bb, int i, int direction, int squares);
+
+    #define _BITBOARD_
+#endif
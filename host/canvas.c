@@ -0,0 +1,61 @@
+// pixel access and piece moves on a ##.puzz canvas: see canvas.h
+
+#include "canvas.h"
+#include <string.h>
+
+uint8_t canvas_get(const uint8_t * canvas, int x, int y) {
+    uint8_t b = canvas[y * CANVAS_STRIDE + x / 2];
+    return x & 1 ? b & 0x0F : b >> 4;
+}
+
+void canvas_set(uint8_t * canvas, int x, int y, uint8_t colour) {
+    uint8_t * b = &canvas[y * CANVAS_STRIDE + x / 2];
+    *b = x & 1 ? (*b & 0xF0) | colour : (*b & 0x0F) | colour << 4;
+}
+
+void canvas_set_palette(uint8_t * canvas, const uint16_t * words) {
+    int i;
+    for (i = 0; i < 16; i++) {
+        canvas[BITMAP_SIZE + 2 * i] = words[i] & 0xFF;
+        canvas[BITMAP_SIZE + 2 * i + 1] = words[i] >> 8;
+    }
+}
+
+static void copy_square(const struct Puzzle * p, const uint8_t * in, uint8_t * out, int row, int col, int to_row,
+                        int to_col) {
+    int x, y, left, top, dx, dy;
+    left = p->top_left_x + col * p->square_width;
+    top = p->top_left_y + row * p->square_height;
+    dx = (to_col - col) * p->square_width;
+    dy = (to_row - row) * p->square_height;
+    for (y = top; y < top + p->square_height; y++) {
+        for (x = left; x < left + p->square_width; x++) {
+            canvas_set(out, x + dx, y + dy, in ? canvas_get(in, x, y) : 0);
+        }
+    }
+}
+
+void canvas_move_pieces(const struct Puzzle * p, const uint8_t from[MAX_DOWN][MAX_ACROSS],
+                        const uint8_t to[MAX_DOWN][MAX_ACROSS], const uint8_t * in, uint8_t * out) {
+    int row, col, from_row[256], from_col[256], to_row[256], to_col[256];
+    uint8_t piece;
+    memcpy(out, in, CANVAS_SIZE);
+    for (row = 0; row < 256; row++) from_row[row] = to_row[row] = -1;
+    for (row = 0; row < p->squares_down; row++) { // each piece's first square, in both layouts
+        for (col = 0; col < p->squares_across; col++) {
+            piece = from[row][col];
+            if (from_row[piece] < 0) from_row[piece] = row, from_col[piece] = col;
+            piece = to[row][col];
+            if (to_row[piece] < 0) to_row[piece] = row, to_col[piece] = col;
+            if (piece != WALL) copy_square(p, NULL, out, row, col, row, col);
+        }
+    }
+    for (row = 0; row < p->squares_down; row++) {
+        for (col = 0; col < p->squares_across; col++) {
+            piece = from[row][col];
+            if (!piece || piece == WALL || to_row[piece] < 0) continue;
+            copy_square(p, in, out, row, col, row + to_row[piece] - from_row[piece],
+                col + to_col[piece] - from_col[piece]);
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef _CANVAS_
+    // the 320x240 4-bit canvas and palette after **CANVAS**, as puzzle_load() reads them into XRAM: two pixels a
+    // byte, the left hand one in the high nibble, then 16 palette words
+    #include "puzzfile.h"
+
+    #define CANVAS_STRIDE (CANVAS_WIDTH / 2)
+    // RP6502 VGA colour: red in bits 0-4, bit 5 opaque, green in bits 6-10, blue in bits 11-15
+    #define PALETTE_WORD(r, g, b) ((uint16_t)((r) >> 3 | 0x20 | ((g) >> 3) << 6 | ((b) >> 3) << 11))
+
+    uint8_t canvas_get(const uint8_t * canvas, int x, int y);
+    void canvas_set(uint8_t * canvas, int x, int y, uint8_t colour);
+    void canvas_set_palette(uint8_t * canvas, const uint16_t * words); // 16 words, stored little-endian
+    // redraw in as out with each piece's squares moved from where they are in from to where they are in to.
+    // Squares that aren't walls in to are cleared to colour 0 first, as gfx_move() leaves emptied squares
+    void canvas_move_pieces(const struct Puzzle * p, const uint8_t from[MAX_DOWN][MAX_ACROSS],
+                            const uint8_t to[MAX_DOWN][MAX_ACROSS], const uint8_t * in, uint8_t * out);
+
+    #define _CANVAS_
+#endif
@@ -0,0 +1,174 @@
+// packed, canonical PUZZ positions: see codec.h
+
+#include "codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int first_cells(const struct Board * b, uint8_t piece, uint16_t * cells, int max) {
+    int i, n;
+    n = 0;
+    for (i = 0; i < b->across * b->down && n < max; i++) {
+        if (b->cell[i] == piece) cells[n++] = i;
+    }
+    return n;
+}
+
+// two pieces have the same shape if their cells are the same offsets from their first cell
+static bool same_shape(const struct Board * b, uint8_t p1, uint8_t p2) {
+    static const int max = MAX_DOWN * MAX_ACROSS;
+    uint16_t * c1, * c2;
+    int n1, n2, i;
+    bool same;
+    c1 = malloc(2 * max * sizeof(uint16_t));
+    c2 = c1 + max;
+    n1 = first_cells(b, p1, c1, max);
+    n2 = first_cells(b, p2, c2, max);
+    same = n1 == n2;
+    for (i = 1; same && i < n1; i++) {
+        same = c1[i] - c1[0] == c2[i] - c2[0];
+    }
+    free(c1);
+    return same;
+}
+
+// give every piece a label, grouping pieces that can stand in for each other into classes
+bool codec_init(struct Codec * c, const struct Puzzle * p) {
+    uint8_t label_of[256], original[256], in_goal[256];
+    int i, j, num_pieces, num_classes, cls;
+    struct Board * b;
+    uint8_t id;
+
+    b = &c->start;
+    board_from_puzzle(b, p);
+    goal_from_puzzle(c->goal, p);
+    memset(label_of, 0, sizeof(label_of));
+    memset(in_goal, 0, sizeof(in_goal));
+    num_pieces = 0;
+    c->num_open = 0;
+    for (i = 0; i < b->across * b->down; i++) {
+        id = b->cell[i];
+        if (id != WALL) c->open[c->num_open++] = i;
+        if (id && id != WALL && !label_of[id]) {
+            label_of[id] = 1;
+            original[num_pieces++] = id;
+        }
+        if (c->goal[i]) in_goal[c->goal[i]] = 1;
+    }
+    // classes: each piece the goal mentions is on its own; the rest are grouped by shape
+    num_classes = 0;
+    c->num_labels = 0;
+    memset(label_of, 0, sizeof(label_of));
+    for (i = 0; i < num_pieces; i++) {
+        if (label_of[original[i]]) continue;
+        cls = num_classes++;
+        c->class_base[cls] = c->num_labels + 1;
+        c->class_size[cls] = 0;
+        for (j = i; j < num_pieces; j++) {
+            id = original[j];
+            if (label_of[id] || (j != i && (in_goal[id] || in_goal[original[i]] || !same_shape(b, original[i], id)))) {
+                continue;
+            }
+            label_of[id] = ++c->num_labels;
+            c->original[label_of[id]] = id;
+            c->class_of[label_of[id]] = cls;
+            c->class_size[cls]++;
+        }
+    }
+    for (i = 0; i < b->across * b->down; i++) {
+        id = b->cell[i];
+        if (id && id != WALL) b->cell[i] = label_of[id];
+        id = c->goal[i];
+        if (id && id != WALL) {
+            if (!label_of[id]) return false; // goal wants a piece that isn't on the board
+            c->goal[i] = label_of[id];
+        }
+    }
+    for (c->bits = 1; (1 << c->bits) <= c->num_labels; c->bits++) continue;
+    c->state_bytes = (c->num_open * c->bits + 7) / 8;
+    return true;
+}
+
+// relabel interchangeable pieces in order of their first cell, so equivalent positions encode the same
+void codec_canonicalize(const struct Codec * c, struct Board * b) {
+    uint8_t map[256], rank[256];
+    uint8_t label, cls;
+    int i;
+    memset(map, 0, c->num_labels + 1);
+    memset(rank, 0, sizeof(rank));
+    for (i = 0; i < c->num_open; i++) {
+        label = b->cell[c->open[i]];
+        if (!label) continue;
+        cls = c->class_of[label];
+        if (c->class_size[cls] == 1) continue;
+        if (!map[label]) map[label] = c->class_base[cls] + rank[cls]++;
+        b->cell[c->open[i]] = map[label];
+    }
+}
+
+void codec_encode(const struct Codec * c, const struct Board * b, uint8_t * state) {
+    unsigned acc, n;
+    int i, k;
+    memset(state, 0, c->state_bytes);
+    acc = n = 0;
+    k = 0;
+    for (i = 0; i < c->num_open; i++) {
+        acc |= (unsigned)b->cell[c->open[i]] << n;
+        n += c->bits;
+        while (n >= 8) {
+            state[k++] = (uint8_t)acc;
+            acc >>= 8;
+            n -= 8;
+        }
+    }
+    if (n) state[k] = (uint8_t)acc;
+}
+
+void codec_decode(const struct Codec * c, const uint8_t * state, struct Board * b) {
+    unsigned acc, n, mask;
+    int i, k;
+    *b = c->start; // walls, dimensions and slide mode
+    mask = (1u << c->bits) - 1;
+    acc = n = 0;
+    k = 0;
+    for (i = 0; i < c->num_open; i++) {
+        while (n < (unsigned)c->bits) {
+            acc |= (unsigned)state[k++] << n;
+            n += 8;
+        }
+        b->cell[c->open[i]] = acc & mask;
+        acc >>= c->bits;
+        n -= c->bits;
+    }
+}
+
+bool codec_moves(const struct Codec * c, const struct Board * b, CodecVisit visit, void * context) {
+    struct Board next;
+    uint8_t state[CODEC_MAX_BYTES];
+    uint16_t anchor[256];
+    uint8_t label;
+    int n, d;
+    bool any;
+    memset(anchor, 0xFF, sizeof(anchor));
+    for (n = 0; n < c->num_open; n++) {
+        label = b->cell[c->open[n]];
+        if (label && anchor[label] == 0xFFFF) anchor[label] = c->open[n];
+    }
+    for (label = 1; label <= c->num_labels; label++) {
+        any = false;
+        for (d = LEFT; d <= DOWN; d++) {
+            next = *b;
+            if (!click(&next, label, d)) continue;
+            any = true;
+            codec_canonicalize(c, &next);
+            codec_encode(c, &next, state);
+            if (!visit(context, &next, state, anchor[label], d)) return false;
+        }
+        next = *b;
+        if (!any && c->start.slide == 2 && slide_pieces(&next, label)) {
+            codec_canonicalize(c, &next);
+            codec_encode(c, &next, state);
+            if (!visit(context, &next, state, anchor[label], PUSH)) return false;
+        }
+    }
+    return true;
+}
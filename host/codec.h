@@ -0,0 +1,32 @@
+#ifndef _CODEC_
+    // packed, canonical encoding of PUZZ positions, shared by the breadth-first solver and the enumerator.
+    // only the cells that aren't walls are stored, bits per cell. Pieces with the same shape that the goal
+    // doesn't mention are interchangeable, so positions that differ only by swapping them encode the same
+    #include "rules.h"
+
+    #define CODEC_MAX_BYTES ((MAX_DOWN * MAX_ACROSS * 8 + 7) / 8)
+
+    struct Codec {
+        struct Board start; // pieces relabelled so that each shape class has consecutive labels
+        uint8_t goal[MAX_DOWN * MAX_ACROSS]; // goal in the same labels
+        uint16_t open[MAX_DOWN * MAX_ACROSS]; // indexes of the cells that aren't walls: only these are stored
+        int num_open, num_labels, bits, state_bytes;
+        uint8_t class_of[256], class_base[256], class_size[256]; // class_ by label, base/size by class
+        uint8_t original[256]; // a piece number from the .puzz for each label
+    };
+
+    // called for each position one click away, with the board, its encoding, the square clicked (the
+    // piece's first cell) and the direction. Return false to stop
+    typedef bool (*CodecVisit)(void * context, const struct Board * next, const uint8_t * state, uint16_t cell,
+                               uint8_t direction);
+
+    // returns false if the goal wants a piece that isn't on the board
+    bool codec_init(struct Codec * c, const struct Puzzle * p);
+    void codec_canonicalize(const struct Codec * c, struct Board * b);
+    void codec_encode(const struct Codec * c, const struct Board * b, uint8_t * state);
+    void codec_decode(const struct Codec * c, const uint8_t * state, struct Board * b);
+    // every click that counts as a move, as in search() of solve.c. Returns false if visit stopped early
+    bool codec_moves(const struct Codec * c, const struct Board * b, CodecVisit visit, void * context);
+
+    #define _CODEC_
+#endif
@@ -0,0 +1,158 @@
+// IDA* for tile-style puzzles, guided by the pattern databases in pdb.c
+
+#include "solve.h"
+#include "pdb.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DEPTH 255
+#define SETTLE_WEIGHT 2 // how many times over the estimate counts once a shortest path is out of reach
+
+struct Search {
+    const struct Pdb * pdb;
+    uint8_t cell[PDB_MAX_CELLS]; // piece in each cell, 0 = empty
+    uint8_t cell_of[256];
+    uint8_t goal[PDB_MAX_CELLS];
+    uint8_t blank, across, down, max_len;
+    uint8_t path[MAX_DEPTH]; // cell the empty square moved to (the square clicked) at each depth
+    unsigned bound, next_bound; // f = moves + weight x estimate
+    unsigned weight;
+    size_t nodes, max_nodes;
+};
+
+static const int8_t step_row[4] = { 0, -1, 0, 1 };
+static const int8_t step_col[4] = { -1, 0, 1, 0 };
+
+static bool at_goal(const struct Search * s) {
+    int i;
+    for (i = 0; i < s->pdb->cells; i++) {
+        if (s->goal[i] && s->goal[i] != s->cell[i]) return false;
+    }
+    return true;
+}
+
+// move the empty square len cells in direction dir, shifting the line of tiles between back towards it
+static void slide_line(struct Search * s, int dir, int len) {
+    int step, i;
+    uint8_t c;
+    step = step_row[dir] * s->across + step_col[dir];
+    for (i = 1; i <= len; i++) {
+        c = s->blank + i * step;
+        s->cell[c - step] = s->cell[c];
+        s->cell_of[s->cell[c]] = c - step;
+    }
+    s->blank += len * step;
+    s->cell[s->blank] = 0;
+    s->cell_of[0] = s->blank;
+}
+
+// last_dir is the direction of the previous move. Line moves never follow a move on the same axis (they could
+// have been one click or none), single moves never undo the previous one
+static bool dfs(struct Search * s, int depth, int last_dir) {
+    unsigned f;
+    int dir, len, row, col;
+    f = depth + s->weight * pdb_estimate(s->pdb, s->cell_of, s->cell);
+    if (f > s->bound) {
+        if (f < s->next_bound) s->next_bound = f;
+        return false;
+    }
+    if (at_goal(s)) {
+        s->bound = depth; // reused to hand back the solution length
+        return true;
+    }
+    if (depth == MAX_DEPTH || s->nodes == s->max_nodes) return false;
+    s->nodes++;
+    row = s->blank / s->across;
+    col = s->blank % s->across;
+    for (dir = 0; dir < 4; dir++) {
+        if (last_dir >= 0 && (s->max_len > 1 ? (dir & 1) == (last_dir & 1) : dir == (last_dir ^ 2))) continue;
+        for (len = 1; len <= s->max_len; len++) {
+            if (row + len * step_row[dir] < 0 || row + len * step_row[dir] >= s->down) break;
+            if (col + len * step_col[dir] < 0 || col + len * step_col[dir] >= s->across) break;
+            slide_line(s, dir, len);
+            s->path[depth] = s->blank;
+            if (dfs(s, depth + 1, dir)) return true;
+            slide_line(s, dir ^ 2, len);
+        }
+    }
+    return false;
+}
+
+// turn the empty square's path into clicks, and check them against rules.c as with solve_bfs()
+static int build_path(const struct Search * s, const struct Puzzle * p, int moves, struct Solution * solution) {
+    struct Board b;
+    uint8_t goal[MAX_DOWN * MAX_ACROSS];
+    struct SolveMove * m;
+    int i, d;
+    if (!(solution->path = malloc((moves + 1) * sizeof(struct SolveMove)))) return SOLVE_NO_MEMORY;
+    board_from_puzzle(&b, p);
+    goal_from_puzzle(goal, p);
+    for (i = 0; i < moves; i++) {
+        m = &solution->path[i];
+        m->row = s->path[i] / s->across;
+        m->col = s->path[i] % s->across;
+        m->piece = AT(&b, m->row, m->col);
+        m->direction = PUSH;
+        for (d = LEFT; d <= DOWN; d++) {
+            if (can_move(&b, m->piece, d)) m->direction = d; // next to the empty square
+        }
+        if (!click(&b, m->piece, m->direction)) return SOLVE_REPLAY_FAILED;
+    }
+    return is_complete(&b, goal) ? moves : SOLVE_REPLAY_FAILED;
+}
+
+// iterative deepening from the start's estimate, until a path turns up or max_nodes runs out
+static bool deepen(struct Search * s) {
+    s->bound = s->weight * pdb_estimate(s->pdb, s->cell_of, s->cell);
+    while (s->bound <= MAX_DEPTH * s->weight) {
+        s->next_bound = ~0u;
+        if (dfs(s, 0, -1)) return true;
+        if (s->nodes == s->max_nodes || s->next_bound == ~0u) return false;
+        s->bound = s->next_bound;
+    }
+    return false;
+}
+
+int solve_ida(const struct Puzzle * p, const struct Pdb * pdb, size_t max_nodes, struct Solution * solution) {
+    struct Search * s;
+    int row, col, cell;
+    size_t nodes;
+    memset(solution, 0, sizeof(*solution));
+    if (!(s = calloc(1, sizeof(*s)))) return solution->moves = SOLVE_NO_MEMORY;
+    s->pdb = pdb;
+    s->max_nodes = max_nodes;
+    s->across = p->squares_across;
+    s->down = p->squares_down;
+    s->max_len = pdb->line_moves ? (s->across > s->down ? s->across : s->down) - 1 : 1;
+    for (row = 0; row < s->down; row++) {
+        for (col = 0; col < s->across; col++) {
+            cell = row * s->across + col;
+            s->cell[cell] = p->grid[row][col];
+            s->cell_of[s->cell[cell]] = cell;
+            s->goal[cell] = p->goal[row][col];
+        }
+    }
+    s->blank = s->cell_of[0];
+    s->weight = 1;
+    solution->moves = SOLVE_UNSOLVABLE;
+    if (deepen(s)) {
+        solution->moves = build_path(s, p, s->bound, solution);
+    } else if (s->nodes == s->max_nodes) {
+        // every path shorter than the bound that ran out has been tried: settle for any path, found quickly
+        solution->at_least = s->bound;
+        nodes = s->nodes;
+        s->nodes = 0;
+        s->weight = SETTLE_WEIGHT;
+        if (deepen(s)) {
+            solution->moves = build_path(s, p, s->bound, solution);
+            if (solution->moves == solution->at_least) solution->at_least = 0; // it was a shortest one after all
+        } else {
+            solution->at_least = 0;
+            solution->moves = SOLVE_LIMIT;
+        }
+        s->nodes += nodes;
+    }
+    solution->states = s->nodes;
+    free(s);
+    return solution->moves;
+}
@@ -0,0 +1,737 @@
+// pattern databases for tile-style PUZZ puzzles, built by breadth-first search backwards from the goal and
+// stored in a memory-mapped file
+
+#include "pdb.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PDB_MAGIC "PUZZPDB2"
+#define PDB_MAX_BUILD_STATES (1UL << 27) // (placements x empty cell) while building: 256 MB of uint16_t
+#define PDB_MAX_COLOURING_ENTRIES (1UL << 25) // a byte each, and a uint32_t each queued while building
+
+struct PdbFileGroup {
+    uint8_t num_tiles, pad[7];
+    uint8_t tiles[PDB_MAX_GROUP_TILES], goal[PDB_MAX_GROUP_TILES];
+    uint64_t offset, entries;
+};
+
+struct PdbFileColouring {
+    uint8_t colour[PDB_MAX_CELLS]; // by goal cell
+    uint8_t count[PDB_COLOURS + 1], pad[4];
+    uint64_t offset, entries;
+};
+
+struct PdbFileHeader {
+    char magic[8];
+    uint8_t across, down, line_moves, num_groups, num_colourings, pad[3];
+    uint8_t goal[PDB_MAX_CELLS]; // the tables are only good for this goal
+    struct PdbFileGroup groups[PDB_MAX_GROUPS];
+    struct PdbFileColouring colourings[PDB_MAX_COLOURINGS];
+};
+
+struct Queue {
+    uint32_t * items;
+    size_t count, capacity;
+};
+
+static const int8_t step_row[4] = { 0, -1, 0, 1 }; // LEFT, UP, RIGHT, DOWN
+static const int8_t step_col[4] = { -1, 0, 1, 0 };
+
+bool pdb_supports(const struct Puzzle * p, char * why, size_t why_size) {
+    int row, col, empty;
+    bool seen[256];
+    uint8_t piece;
+    if (p->squares_across * p->squares_down > PDB_MAX_CELLS) {
+        snprintf(why, why_size, "more than %d squares", PDB_MAX_CELLS);
+        return false;
+    }
+    memset(seen, 0, sizeof(seen));
+    empty = 0;
+    for (row = 0; row < p->squares_down; row++) {
+        for (col = 0; col < p->squares_across; col++) {
+            piece = p->grid[row][col];
+            if (piece == WALL) {
+                snprintf(why, why_size, "has walls");
+                return false;
+            }
+            if (!piece) {
+                empty++;
+            } else if (seen[piece]) {
+                snprintf(why, why_size, "piece %u is bigger than one square", piece);
+                return false;
+            }
+            seen[piece] = true;
+        }
+    }
+    if (empty != 1) {
+        snprintf(why, why_size, "has %d empty squares, not 1", empty);
+        return false;
+    }
+    return true;
+}
+
+uint32_t pdb_rank(const uint8_t * cells, int k, int n) {
+    uint32_t used, rank;
+    int i;
+    used = rank = 0;
+    for (i = 0; i < k; i++) {
+        rank = rank * (n - i) + cells[i] - __builtin_popcount(used & ((1u << cells[i]) - 1));
+        used |= 1u << cells[i];
+    }
+    return rank;
+}
+
+static void unrank(uint32_t rank, uint8_t * cells, int k, int n) {
+    int digit[PDB_MAX_GROUP_TILES];
+    uint32_t used;
+    int i, c, skip;
+    for (i = k - 1; i >= 0; i--) {
+        digit[i] = rank % (n - i);
+        rank /= n - i;
+    }
+    used = 0;
+    for (i = 0; i < k; i++) {
+        for (c = 0, skip = digit[i]; ; c++) {
+            if (used & (1u << c)) continue;
+            if (!skip--) break;
+        }
+        cells[i] = c;
+        used |= 1u << c;
+    }
+}
+
+static uint32_t placements(int k, int n) {
+    uint32_t entries;
+    int i;
+    for (entries = 1, i = 0; i < k; i++) entries *= n - i;
+    return entries;
+}
+
+static bool push(struct Queue * b, uint32_t state) {
+    if (b->count == b->capacity) {
+        b->capacity = b->capacity ? b->capacity * 2 : 4096;
+        if (!(b->items = realloc(b->items, b->capacity * sizeof(uint32_t)))) return false;
+    }
+    b->items[b->count++] = state;
+    return true;
+}
+
+// Dijkstra (with a bucket queue, as a move costs 1 if it moves one of the group's tiles and 0 if not) over
+// (placement of the group's tiles, empty cell), outwards from every goal placement. Moves are reversible at the
+// same cost, so this gives distance to the goal. Moves are of one tile: line moves use colourings instead
+static bool build_group(const struct Pdb * pdb, const struct PdbGroup * g, uint16_t * table) {
+    struct Queue bucket[2];
+    int n, k, i, j, dir, moved, row, col;
+    uint8_t cells[PDB_MAX_GROUP_TILES], next[PDB_MAX_GROUP_TILES];
+    int8_t who[PDB_MAX_CELLS];
+    uint16_t * dist, d, nd;
+    uint32_t rank, next_rank, s, t;
+    size_t pending, states;
+    uint8_t blank, target;
+    bool ok;
+
+    n = pdb->cells;
+    k = g->num_tiles;
+    states = (size_t)g->entries * n;
+    if (!(dist = malloc(states * sizeof(uint16_t)))) return false;
+    memset(dist, 0xFF, states * sizeof(uint16_t));
+    memset(bucket, 0, sizeof(bucket));
+    memset(who, -1, sizeof(who));
+    ok = true;
+
+    rank = pdb_rank(g->goal, k, n);
+    for (i = 0; i < k; i++) who[g->goal[i]] = i;
+    pending = 0;
+    for (blank = 0; blank < n; blank++) {
+        if (who[blank] >= 0) continue;
+        dist[rank * n + blank] = 0;
+        ok = ok && push(&bucket[0], rank * n + blank);
+        pending++;
+    }
+    for (i = 0; i < k; i++) who[g->goal[i]] = -1;
+
+    for (d = 0; ok && pending; d++) {
+        struct Queue * b = &bucket[d % 2];
+        while (ok && b->count) {
+            s = b->items[--b->count];
+            pending--;
+            if (dist[s] != d) continue; // already reached more cheaply
+            rank = s / n;
+            blank = s % n;
+            unrank(rank, cells, k, n);
+            for (i = 0; i < k; i++) who[cells[i]] = i;
+            row = blank / pdb->across;
+            col = blank % pdb->across;
+            for (dir = 0; dir < 4; dir++) {
+                if (row + step_row[dir] < 0 || row + step_row[dir] >= pdb->down) continue;
+                if (col + step_col[dir] < 0 || col + step_col[dir] >= pdb->across) continue;
+                // the tile at target moves back into the empty cell
+                target = blank + step_row[dir] * pdb->across + step_col[dir];
+                moved = (j = who[target]) >= 0;
+                if (moved) {
+                    memcpy(next, cells, k);
+                    next[j] = blank;
+                }
+                next_rank = moved ? pdb_rank(next, k, n) : rank;
+                nd = d + moved;
+                t = next_rank * n + target;
+                if (nd < dist[t]) {
+                    dist[t] = nd;
+                    ok = ok && push(&bucket[nd % 2], t);
+                    pending++;
+                }
+            }
+            for (i = 0; i < k; i++) who[cells[i]] = -1;
+        }
+    }
+    for (rank = 0; rank < g->entries; rank++) {
+        table[rank] = 0xFFFF;
+        for (blank = 0; blank < n; blank++) {
+            if (dist[rank * n + blank] < table[rank]) table[rank] = dist[rank * n + blank];
+        }
+        if (table[rank] == 0xFFFF) table[rank] = 0; // can't happen with a spare tile outside the group
+    }
+    for (i = 0; i < 2; i++) free(bucket[i].items);
+    free(dist);
+    return ok;
+}
+
+static void fill_binomials(struct Pdb * pdb) {
+    int n, k;
+    for (n = 0; n <= PDB_MAX_CELLS; n++) {
+        pdb->binomial[n][0] = 1;
+        for (k = 1; k <= n; k++) pdb->binomial[n][k] = pdb->binomial[n - 1][k - 1] + pdb->binomial[n - 1][k];
+    }
+}
+
+// rank of the colours in each cell: for each colour in turn, starting with the empty square, the colex rank of
+// its cells among those the colours before it left. The unpainted pieces fill whatever is left over
+static uint32_t colour_rank(const struct Pdb * pdb, const struct PdbColouring * c, const uint8_t * colours) {
+    uint32_t rank, part, taken;
+    int k, i, left, seen, found;
+    rank = taken = 0;
+    left = pdb->cells;
+    for (k = 0; k <= PDB_COLOURS && left > c->count[k]; k++) { // then the rest are all this colour: part 0
+        part = 0;
+        for (seen = found = i = 0; found < c->count[k]; i++) {
+            if (taken & (1u << i)) continue;
+            if (colours[i] == k) {
+                part += pdb->binomial[seen][++found];
+                taken |= 1u << i;
+            }
+            seen++;
+        }
+        rank = rank * pdb->binomial[left][c->count[k]] + part;
+        left -= c->count[k];
+    }
+    return rank;
+}
+
+static void colour_unrank(const struct Pdb * pdb, const struct PdbColouring * c, uint32_t rank, uint8_t * colours) {
+    uint32_t part[PDB_COLOURS + 1];
+    uint8_t cell[PDB_MAX_CELLS];
+    int left[PDB_COLOURS + 1]; // cells not yet coloured when each colour's turn comes
+    int k, i, j, x, n;
+    for (n = pdb->cells, k = 0; k <= PDB_COLOURS; n -= c->count[k], k++) left[k] = n;
+    for (k = PDB_COLOURS; k >= 0; k--) {
+        part[k] = rank % pdb->binomial[left[k]][c->count[k]];
+        rank /= pdb->binomial[left[k]][c->count[k]];
+    }
+    memset(colours, PDB_COLOURS + 1, pdb->cells);
+    for (k = 0; k <= PDB_COLOURS; k++) {
+        for (n = i = 0; i < pdb->cells; i++) {
+            if (colours[i] == PDB_COLOURS + 1) cell[n++] = i;
+        }
+        for (j = c->count[k]; j > 0; j--) {
+            for (x = j - 1; pdb->binomial[x + 1][j] <= part[k]; x++) continue; // the last x with C(x, j) <= part
+            part[k] -= pdb->binomial[x][j];
+            colours[cell[x]] = k;
+        }
+    }
+}
+
+// breadth-first over the colours in each cell, outwards from every goal arrangement: painted tiles on the goal
+// squares of their colour, and the empty square on any cell the goal leaves free. Moves are reversible, so this
+// gives distance to the goal
+static bool build_colouring(const struct Pdb * pdb, const struct PdbColouring * c, const uint8_t * goal_colours,
+    uint8_t * table) {
+    struct Queue queue;
+    uint8_t colours[PDB_MAX_CELLS], next[PDB_MAX_CELLS], d;
+    int i, dir, len, max_len, row, col, step, blank;
+    uint32_t rank;
+    size_t head;
+    bool ok;
+
+    max_len = (pdb->across > pdb->down ? pdb->across : pdb->down) - 1;
+    memset(table, 0xFF, c->entries);
+    memset(&queue, 0, sizeof(queue));
+    ok = true;
+    for (blank = 0; blank < pdb->cells; blank++) {
+        if (goal_colours[blank]) continue;
+        for (i = 0; i < pdb->cells; i++) colours[i] = goal_colours[i] ? goal_colours[i] : PDB_COLOURS + 1;
+        colours[blank] = 0;
+        rank = colour_rank(pdb, c, colours);
+        table[rank] = 0;
+        ok = ok && push(&queue, rank);
+    }
+    for (head = 0; ok && head < queue.count; head++) {
+        rank = queue.items[head];
+        d = table[rank] < 0xFE ? table[rank] + 1 : 0xFE; // still a lower bound
+        colour_unrank(pdb, c, rank, colours);
+        for (blank = 0; colours[blank]; blank++) continue;
+        row = blank / pdb->across;
+        col = blank % pdb->across;
+        for (dir = 0; dir < 4; dir++) {
+            step = step_row[dir] * pdb->across + step_col[dir];
+            memcpy(next, colours, pdb->cells);
+            for (len = 1; len <= max_len; len++) {
+                if (row + len * step_row[dir] < 0 || row + len * step_row[dir] >= pdb->down) break;
+                if (col + len * step_col[dir] < 0 || col + len * step_col[dir] >= pdb->across) break;
+                // one more tile of the line shifts back towards the empty cell
+                next[blank + (len - 1) * step] = next[blank + len * step];
+                next[blank + len * step] = 0;
+                rank = colour_rank(pdb, c, next);
+                if (table[rank] == 0xFF) {
+                    table[rank] = d;
+                    ok = ok && push(&queue, rank);
+                }
+            }
+        }
+    }
+    for (rank = 0; rank < c->entries; rank++) {
+        if (table[rank] == 0xFF) table[rank] = 0; // can't happen: tiles of a colour can always be swapped
+    }
+    free(queue.items);
+    return ok;
+}
+
+static uint64_t choose(int n, int k) {
+    uint64_t r;
+    int i;
+    for (r = 1, i = 0; i < k; i++) r = r * (n - i) / (i + 1);
+    return r;
+}
+
+// arrangements of the empty square and count[] tiles of each colour over cells
+static uint64_t colour_entries(const uint8_t * count, int cells) {
+    uint64_t entries;
+    int k;
+    for (entries = 1, k = 0; k <= PDB_COLOURS; cells -= count[k], k++) entries *= choose(cells, count[k]);
+    return entries;
+}
+
+// paint the first goal tiles in order (cells in goal order), as many as fit, in PDB_COLOURS runs of nearly equal
+// length, so each colour is a compact band of rows or columns
+static void plan_colouring(struct PdbFileColouring * c, const uint8_t * goal, const uint8_t * order, int cells) {
+    int num_goal, painted, i, k, run;
+    for (num_goal = i = 0; i < cells; i++) num_goal += goal[order[i]] && goal[order[i]] != WALL;
+    for (painted = num_goal; ; painted--) {
+        c->count[0] = 1;
+        for (k = 1; k <= PDB_COLOURS; k++) c->count[k] = painted / PDB_COLOURS + (k <= painted % PDB_COLOURS);
+        if (painted <= PDB_COLOURS || colour_entries(c->count, cells) <= PDB_MAX_COLOURING_ENTRIES) break;
+    }
+    memset(c->colour, PDB_COLOURS + 1, sizeof(c->colour));
+    for (k = 1, run = i = 0; i < cells; i++) {
+        if (!goal[order[i]] || goal[order[i]] == WALL) {
+            c->colour[order[i]] = 0;
+        } else if (k <= PDB_COLOURS) {
+            c->colour[order[i]] = k;
+            if (++run == c->count[k]) k++, run = 0;
+        }
+    }
+    c->entries = colour_entries(c->count, cells);
+}
+
+// fill in everything but the tables: dimensions, and the tile groups or the colourings
+static void plan(struct PdbFileHeader * h, const struct Puzzle * p, int max_group_tiles) {
+    int row, col, cell, num_goal, i, k;
+    uint8_t goal_tiles[PDB_MAX_CELLS], goal_cells[PDB_MAX_CELLS], order[PDB_MAX_CELLS];
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, PDB_MAGIC, sizeof(h->magic));
+    h->across = p->squares_across;
+    h->down = p->squares_down;
+    h->line_moves = p->slide == 2;
+    num_goal = 0;
+    for (row = 0; row < h->down; row++) {
+        for (col = 0; col < h->across; col++) {
+            cell = row * h->across + col;
+            h->goal[cell] = p->goal[row][col];
+            if (h->goal[cell] && h->goal[cell] != WALL) {
+                goal_tiles[num_goal] = h->goal[cell];
+                goal_cells[num_goal++] = cell;
+            }
+        }
+    }
+    if (h->line_moves) {
+        for (cell = 0; cell < PDB_MAX_CELLS; cell++) order[cell] = cell;
+        plan_colouring(&h->colourings[h->num_colourings++], h->goal, order, h->across * h->down);
+        for (i = col = 0; col < h->across; col++) {
+            for (row = 0; row < h->down; row++) order[i++] = row * h->across + col;
+        }
+        plan_colouring(&h->colourings[h->num_colourings++], h->goal, order, h->across * h->down);
+        return;
+    }
+    k = max_group_tiles;
+    if (k <= 0) {
+        for (k = PDB_MAX_GROUP_TILES; k > 1; k--) {
+            if ((unsigned long)placements(k, h->across * h->down) * h->across * h->down <= PDB_MAX_BUILD_STATES) break;
+        }
+    }
+    if (k > PDB_MAX_GROUP_TILES) k = PDB_MAX_GROUP_TILES;
+    // groups of goal tiles in goal order, which keeps each group to a compact band of rows
+    for (i = 0; i < num_goal && h->num_groups < PDB_MAX_GROUPS; i += k) {
+        struct PdbFileGroup * g = &h->groups[h->num_groups++];
+        g->num_tiles = num_goal - i < k ? num_goal - i : k;
+        memcpy(g->tiles, goal_tiles + i, g->num_tiles);
+        memcpy(g->goal, goal_cells + i, g->num_tiles);
+        g->entries = placements(g->num_tiles, h->across * h->down);
+    }
+}
+
+// a colouring from the file's, which colours goal cells, to colour pieces
+static void read_colouring(struct PdbColouring * c, const struct PdbFileColouring * fc, const uint8_t * goal,
+    int cells) {
+    int i;
+    memset(c->colour, PDB_COLOURS + 1, sizeof(c->colour));
+    c->colour[0] = 0;
+    for (i = 0; i < cells; i++) {
+        if (goal[i] && goal[i] != WALL) c->colour[goal[i]] = fc->colour[i];
+    }
+    memcpy(c->count, fc->count, sizeof(c->count));
+    c->entries = fc->entries;
+}
+
+static bool map_file(struct Pdb * pdb, const char * path, const struct PdbFileHeader * want) {
+    const struct PdbFileHeader * h;
+    struct stat st;
+    int fd, i;
+    size_t end;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*h)) {
+        close(fd);
+        return false;
+    }
+    pdb->map_size = st.st_size;
+    pdb->map = mmap(NULL, pdb->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pdb->map == MAP_FAILED) {
+        pdb->map = NULL;
+        return false;
+    }
+    h = pdb->map;
+    if (memcmp(h->magic, want->magic, sizeof(h->magic)) || h->across != want->across || h->down != want->down
+        || h->line_moves != want->line_moves || memcmp(h->goal, want->goal, sizeof(h->goal))
+        || h->num_colourings != want->num_colourings || h->num_colourings > PDB_MAX_COLOURINGS
+        || (want->num_groups && h->groups[0].num_tiles != want->groups[0].num_tiles)) {
+        pdb_close(pdb);
+        return false;
+    }
+    pdb->across = h->across;
+    pdb->down = h->down;
+    pdb->cells = h->across * h->down;
+    pdb->line_moves = h->line_moves;
+    pdb->num_groups = h->num_groups;
+    pdb->num_colourings = h->num_colourings;
+    for (i = 0; i < h->num_groups; i++) {
+        end = h->groups[i].offset + h->groups[i].entries * sizeof(uint16_t);
+        if (end > pdb->map_size || h->groups[i].entries != placements(h->groups[i].num_tiles, pdb->cells)) {
+            pdb_close(pdb);
+            return false;
+        }
+        pdb->groups[i].num_tiles = h->groups[i].num_tiles;
+        memcpy(pdb->groups[i].tiles, h->groups[i].tiles, PDB_MAX_GROUP_TILES);
+        memcpy(pdb->groups[i].goal, h->groups[i].goal, PDB_MAX_GROUP_TILES);
+        pdb->groups[i].entries = h->groups[i].entries;
+        pdb->groups[i].table = (const uint16_t *)((const char *)pdb->map + h->groups[i].offset);
+    }
+    for (i = 0; i < h->num_colourings; i++) {
+        if (h->colourings[i].offset + h->colourings[i].entries > pdb->map_size
+            || h->colourings[i].entries != colour_entries(h->colourings[i].count, pdb->cells)) {
+            pdb_close(pdb);
+            return false;
+        }
+        read_colouring(&pdb->colourings[i], &h->colourings[i], h->goal, pdb->cells);
+        pdb->colourings[i].table = (const uint8_t *)pdb->map + h->colourings[i].offset;
+    }
+    return true;
+}
+
+static bool build_file(const char * path, struct PdbFileHeader * h, bool verbose) {
+    struct Pdb pdb;
+    uint16_t * table;
+    uint8_t * colour_table;
+    char temp[4096];
+    FILE * fp;
+    uint64_t offset;
+    time_t started;
+    int i;
+    bool ok;
+
+    memset(&pdb, 0, sizeof(pdb));
+    pdb.across = h->across;
+    pdb.down = h->down;
+    pdb.cells = h->across * h->down;
+    pdb.line_moves = h->line_moves;
+    fill_binomials(&pdb);
+    offset = sizeof(*h);
+    for (i = 0; i < h->num_groups; i++) {
+        h->groups[i].offset = offset;
+        offset += h->groups[i].entries * sizeof(uint16_t);
+    }
+    for (i = 0; i < h->num_colourings; i++) {
+        h->colourings[i].offset = offset;
+        offset += h->colourings[i].entries;
+    }
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    if (!(fp = fopen(temp, "wb"))) return false;
+    ok = fwrite(h, sizeof(*h), 1, fp) == 1;
+    for (i = 0; ok && i < h->num_groups; i++) {
+        pdb.groups[i].num_tiles = h->groups[i].num_tiles;
+        memcpy(pdb.groups[i].goal, h->groups[i].goal, PDB_MAX_GROUP_TILES);
+        pdb.groups[i].entries = h->groups[i].entries;
+        started = time(NULL);
+        ok = (table = malloc(pdb.groups[i].entries * sizeof(uint16_t))) && build_group(&pdb, &pdb.groups[i], table);
+        ok = ok && fwrite(table, sizeof(uint16_t), pdb.groups[i].entries, fp) == pdb.groups[i].entries;
+        free(table);
+        if (verbose) {
+            fprintf(stderr, "pattern database group %d: %u tiles, %u entries, %lds\n", i, h->groups[i].num_tiles,
+                pdb.groups[i].entries, (long)(time(NULL) - started));
+        }
+    }
+    for (i = 0; ok && i < h->num_colourings; i++) {
+        read_colouring(&pdb.colourings[i], &h->colourings[i], h->goal, pdb.cells);
+        started = time(NULL);
+        ok = (colour_table = malloc(pdb.colourings[i].entries))
+            && build_colouring(&pdb, &pdb.colourings[i], h->colourings[i].colour, colour_table);
+        ok = ok && fwrite(colour_table, 1, pdb.colourings[i].entries, fp) == pdb.colourings[i].entries;
+        free(colour_table);
+        if (verbose) {
+            fprintf(stderr, "pattern database colouring %d: %u+%u+%u tiles, %u entries, %lds\n", i,
+                pdb.colourings[i].count[1], pdb.colourings[i].count[2], pdb.colourings[i].count[3],
+                pdb.colourings[i].entries, (long)(time(NULL) - started));
+        }
+    }
+    ok = !fclose(fp) && ok;
+    if (ok) ok = !rename(temp, path);
+    if (!ok) remove(temp);
+    return ok;
+}
+
+struct WalkBuild {
+    struct PdbWalk * w;
+    uint64_t * queue;
+    size_t queued, capacity, used;
+    uint8_t d;
+    bool ok;
+};
+
+static uint64_t walk_key(const struct PdbWalk * w, uint8_t count[][PDB_WALK_MAX_LINES + 1], int blank_line) {
+    uint64_t key;
+    int line, t;
+    key = blank_line;
+    for (line = 0; line < w->lines; line++) {
+        for (t = 0; t <= w->lines; t++) key = key << w->bits | count[line][t];
+    }
+    return key;
+}
+
+static size_t walk_slot(const struct PdbWalk * w, uint64_t key) {
+    size_t i;
+    for (i = (size_t)((key + 1) * 0x9E3779B97F4A7C15ull >> 20) & w->mask; w->keys[i] && w->keys[i] != key + 1; ) {
+        i = (i + 1) & w->mask;
+    }
+    return i;
+}
+
+static bool walk_grow(struct PdbWalk * w) {
+    struct PdbWalk bigger;
+    size_t i, j;
+    bigger = *w;
+    bigger.mask = w->mask * 2 + 1;
+    bigger.keys = calloc(bigger.mask + 1, sizeof(uint64_t));
+    bigger.dist = malloc(bigger.mask + 1);
+    if (!bigger.keys || !bigger.dist) {
+        free(bigger.keys);
+        free(bigger.dist);
+        return false;
+    }
+    for (i = 0; i <= w->mask; i++) {
+        if (!w->keys[i]) continue;
+        j = walk_slot(&bigger, w->keys[i] - 1);
+        bigger.keys[j] = w->keys[i];
+        bigger.dist[j] = w->dist[i];
+    }
+    free(w->keys);
+    free(w->dist);
+    *w = bigger;
+    return true;
+}
+
+static void walk_visit(struct WalkBuild * b, uint8_t count[][PDB_WALK_MAX_LINES + 1], int blank_line) {
+    uint64_t key;
+    size_t i;
+    if (!b->ok) return;
+    if (b->used * 2 >= b->w->mask && !walk_grow(b->w)) {
+        b->ok = false;
+        return;
+    }
+    key = walk_key(b->w, count, blank_line);
+    i = walk_slot(b->w, key);
+    if (b->w->keys[i]) return;
+    b->w->keys[i] = key + 1;
+    b->w->dist[i] = b->d;
+    b->used++;
+    if (b->queued == b->capacity) {
+        b->capacity = b->capacity ? b->capacity * 2 : 4096;
+        if (!(b->queue = realloc(b->queue, b->capacity * sizeof(uint64_t)))) {
+            b->ok = false;
+            return;
+        }
+    }
+    b->queue[b->queued++] = key;
+}
+
+// the empty square has reached line - step: shift a tile of any kind from line back into it, and carry on
+static void walk_expand(struct WalkBuild * b, uint8_t count[][PDB_WALK_MAX_LINES + 1], int line, int step, int len,
+    int max_len) {
+    int t;
+    if (line < 0 || line >= b->w->lines || len > max_len) return;
+    for (t = 0; t <= b->w->lines; t++) {
+        if (!count[line][t]) continue;
+        count[line][t]--;
+        count[line - step][t]++;
+        walk_visit(b, count, line);
+        walk_expand(b, count, line + step, step, len + 1, max_len);
+        count[line][t]++;
+        count[line - step][t]--;
+    }
+}
+
+// breadth-first search outwards from every goal arrangement, one click per (vertical or horizontal) move
+static bool build_walk(struct PdbWalk * w, const struct Pdb * pdb, const uint8_t * goal, int columns) {
+    struct WalkBuild b;
+    uint8_t count[PDB_WALK_MAX_LINES][PDB_WALK_MAX_LINES + 1];
+    uint8_t spare[PDB_WALK_MAX_LINES];
+    int line_len, cell, line, t, max_len;
+    size_t next;
+    uint64_t key;
+
+    w->lines = columns ? pdb->across : pdb->down;
+    line_len = columns ? pdb->down : pdb->across;
+    for (w->bits = 1; (1 << w->bits) <= (line_len > w->lines ? line_len : w->lines); w->bits++) continue;
+    if (w->lines > PDB_WALK_MAX_LINES || (w->lines * (w->lines + 1) + 1) * w->bits > 64) return true; // no table
+    max_len = pdb->line_moves ? w->lines - 1 : 1;
+    memset(w->type, w->lines, sizeof(w->type));
+    memset(count, 0, sizeof(count));
+    for (line = 0; line < w->lines; line++) spare[line] = line_len;
+    for (cell = 0; cell < pdb->cells; cell++) {
+        line = columns ? cell % pdb->across : cell / pdb->across;
+        if (goal[cell]) {
+            w->type[goal[cell]] = line;
+            count[line][line]++;
+            spare[line]--;
+        }
+    }
+    w->mask = 4095;
+    w->keys = calloc(w->mask + 1, sizeof(uint64_t));
+    w->dist = malloc(w->mask + 1);
+    memset(&b, 0, sizeof(b));
+    b.w = w;
+    b.ok = w->keys && w->dist;
+    // pieces with no goal square, and the empty square, fill whatever the goal leaves over
+    for (line = 0; line < w->lines; line++) {
+        if (!spare[line]) continue;
+        for (t = 0; t < w->lines; t++) count[t][w->lines] = spare[t] - (t == line);
+        walk_visit(&b, count, line);
+    }
+    for (next = 0; b.ok && next < b.queued; next++) {
+        key = b.queue[next];
+        b.d = w->dist[walk_slot(w, key)] + 1;
+        for (line = w->lines - 1; line >= 0; line--) {
+            for (t = w->lines; t >= 0; t--) {
+                count[line][t] = key & ((1 << w->bits) - 1);
+                key >>= w->bits;
+            }
+        }
+        walk_expand(&b, count, (int)key - 1, -1, 1, max_len);
+        walk_expand(&b, count, (int)key + 1, 1, 1, max_len);
+    }
+    free(b.queue);
+    return b.ok;
+}
+
+static unsigned walk_estimate(const struct Pdb * pdb, const struct PdbWalk * w, const uint8_t * cell_of, int columns) {
+    uint8_t count[PDB_WALK_MAX_LINES][PDB_WALK_MAX_LINES + 1];
+    size_t i;
+    int j, cell;
+    if (!w->keys) return 0;
+    memset(count, 0, sizeof(count));
+    for (j = 0; j < pdb->num_pieces; j++) {
+        cell = cell_of[pdb->pieces[j]];
+        count[columns ? cell % pdb->across : cell / pdb->across][w->type[pdb->pieces[j]]]++;
+    }
+    cell = cell_of[0];
+    i = walk_slot(w, walk_key(w, count, columns ? cell % pdb->across : cell / pdb->across));
+    return w->keys[i] ? w->dist[i] : 0;
+}
+
+bool pdb_open(struct Pdb * pdb, const struct Puzzle * p, const char * path, int max_group_tiles, bool verbose) {
+    struct PdbFileHeader want;
+    uint8_t piece;
+    int i;
+    memset(pdb, 0, sizeof(*pdb));
+    fill_binomials(pdb);
+    plan(&want, p, max_group_tiles);
+    if (!max_group_tiles) want.num_groups = 0; // any grouping already on disk will do
+    if (!map_file(pdb, path, &want)) {
+        plan(&want, p, max_group_tiles);
+        if (verbose) fprintf(stderr, "building pattern databases in %s\n", path);
+        if (!build_file(path, &want, verbose) || !map_file(pdb, path, &want)) return false;
+    }
+    for (i = 0; i < pdb->cells; i++) {
+        piece = p->grid[i / pdb->across][i % pdb->across];
+        if (piece) pdb->pieces[pdb->num_pieces++] = piece;
+    }
+    if (!build_walk(&pdb->walk[0], pdb, want.goal, 0) || !build_walk(&pdb->walk[1], pdb, want.goal, 1)) {
+        pdb_close(pdb);
+        return false;
+    }
+    return true;
+}
+
+void pdb_close(struct Pdb * pdb) {
+    int i;
+    if (pdb->map) munmap(pdb->map, pdb->map_size);
+    pdb->map = NULL;
+    for (i = 0; i < 2; i++) {
+        free(pdb->walk[i].keys);
+        free(pdb->walk[i].dist);
+        pdb->walk[i].keys = NULL;
+        pdb->walk[i].dist = NULL;
+    }
+}
+
+unsigned pdb_estimate(const struct Pdb * pdb, const uint8_t * cell_of, const uint8_t * cell) {
+    uint8_t cells[PDB_MAX_GROUP_TILES], colours[PDB_MAX_CELLS];
+    const struct PdbColouring * c;
+    unsigned h, v, walk;
+    int i, j;
+    for (h = 0, i = 0; i < pdb->num_groups; i++) {
+        for (j = 0; j < pdb->groups[i].num_tiles; j++) cells[j] = cell_of[pdb->groups[i].tiles[j]];
+        h += pdb->groups[i].table[pdb_rank(cells, pdb->groups[i].num_tiles, pdb->cells)];
+    }
+    for (i = 0; i < pdb->num_colourings; i++) {
+        c = &pdb->colourings[i];
+        for (j = 0; j < pdb->cells; j++) colours[j] = c->colour[cell[j]];
+        v = c->table[colour_rank(pdb, c, colours)];
+        if (v > h) h = v;
+    }
+    walk = walk_estimate(pdb, &pdb->walk[0], cell_of, 0) + walk_estimate(pdb, &pdb->walk[1], cell_of, 1);
+    return walk > h ? walk : h;
+}
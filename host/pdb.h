@@ -0,0 +1,69 @@
+#ifndef _PDB_
+    // pattern databases for tile-style puzzles (every piece one square, one empty square, no walls), such as the
+    // 15 puzzle in 00.puzz. The goal's tiles are split into disjoint groups; each group's table holds the exact
+    // cost of getting just those tiles home, with the other tiles treated as identical, and the groups add up.
+    // tables are kept in a file that is memory-mapped, so only the first run pays for building them
+    #include "puzzfile.h"
+
+    #define PDB_MAX_CELLS 32
+    #define PDB_MAX_GROUPS 8
+    #define PDB_MAX_GROUP_TILES 8
+
+    // in slide mode 2 one click can push a whole line of tiles, and tile groups can't share such a click
+    // out between them. Instead, each colouring paints the goal's tiles in a few colours, tiles of one colour
+    // being interchangeable, and its table holds the exact number of clicks to get every painted tile home to
+    // a goal square of its colour. Each one is a lower bound on its own, and the largest is used
+    #define PDB_COLOURS 3
+    #define PDB_MAX_COLOURINGS 2 // by goal rows, by goal columns
+
+    struct PdbGroup {
+        uint8_t num_tiles;
+        uint8_t tiles[PDB_MAX_GROUP_TILES]; // piece numbers
+        uint8_t goal[PDB_MAX_GROUP_TILES]; // their goal cells
+        uint32_t entries;
+        const uint16_t * table; // by rank of the tiles' cells
+    };
+
+    struct PdbColouring {
+        uint8_t colour[256]; // by piece: 1 to PDB_COLOURS, or PDB_COLOURS + 1 for unpainted pieces
+        uint8_t count[PDB_COLOURS + 1]; // squares of each colour, the empty one as colour 0
+        uint32_t entries;
+        const uint8_t * table; // by rank of the squares' colours
+    };
+
+    // walking distance: a lower bound on the vertical (or horizontal) clicks needed, found from how many tiles
+    // bound for each row (column) are in each row (column). Vertical and horizontal clicks add up
+    #define PDB_WALK_MAX_LINES 7 // keys are (lines x (lines + 1) + 1) counts, which must fit in 64 bits
+
+    struct PdbWalk {
+        uint8_t lines, bits;
+        uint8_t type[256]; // goal line of each piece, lines for pieces that can finish anywhere
+        uint64_t * keys; // open hash of key + 1, 0 = unused
+        uint8_t * dist;
+        size_t mask;
+    };
+
+    struct Pdb {
+        uint8_t across, down, cells, line_moves, num_groups, num_colourings;
+        struct PdbGroup groups[PDB_MAX_GROUPS]; // without line moves
+        struct PdbColouring colourings[PDB_MAX_COLOURINGS]; // with them
+        uint8_t num_pieces, pieces[PDB_MAX_CELLS];
+        uint32_t binomial[PDB_MAX_CELLS + 1][PDB_MAX_CELLS + 1]; // for ranking colourings
+        struct PdbWalk walk[2]; // by rows, by columns. No table (keys NULL) if the board is too big
+        void * map;
+        size_t map_size;
+    };
+
+    // returns false, with the reason in why, if p isn't a tile-style puzzle
+    bool pdb_supports(const struct Puzzle * p, char * why, size_t why_size);
+    // map the tables in path if they were built for p's goal and slide mode, otherwise build and write them.
+    // max_group_tiles of 0 picks the largest groups that build in reasonable memory; line moves have no groups
+    bool pdb_open(struct Pdb * pdb, const struct Puzzle * p, const char * path, int max_group_tiles, bool verbose);
+    void pdb_close(struct Pdb * pdb);
+    uint32_t pdb_rank(const uint8_t * cells, int k, int n); // rank of k distinct cells out of n
+    // admissible estimate of the clicks needed, from the cell of each piece (cell_of[piece]) and the piece in
+    // each cell (cell[cell], 0 for the empty one)
+    unsigned pdb_estimate(const struct Pdb * pdb, const uint8_t * cell_of, const uint8_t * cell);
+
+    #define _PDB_
+#endif
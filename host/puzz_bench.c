@@ -0,0 +1,181 @@
+// puzz_bench: check the bitboard move generator (bitboard.c) against the reference rules (rules.c), then time
+// both, in positions expanded per second
+// usage: puzz_bench [-n positions] [-s seed] file.puzz...
+// the positions are a random walk of clicks from each puzzle's start. At every one, every piece and direction
+// is tested both ways and every move made both ways, and the boards must agree
+
+#include "bitboard.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_POSITIONS 20000
+#define MIN_SECONDS 0.5 // time each generator for at least this long
+
+static uint32_t seed = 2463534242u;
+
+static uint32_t next_random(void) { // xorshift32, so runs repeat exactly
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_bench [-n positions] [-s seed] file.puzz...\n"
+        "  -n  positions to check and time, a random walk from the start (default %d)\n"
+        "  -s  random seed\n", DEFAULT_POSITIONS);
+    exit(1);
+}
+
+// one click at random, PUSH included, that counts as a move
+static void random_click(struct Board * b, const struct Bitboard * bb) {
+    struct Board next;
+    int tries;
+    for (tries = 0; tries < 1000; tries++) {
+        next = *b;
+        if (click(&next, bb->id[next_random() % bb->num_pieces], LEFT + next_random() % 5)) {
+            *b = next;
+            return;
+        }
+    }
+}
+
+static bool check(const char * filename, const struct Board * start, struct Board * walk, int positions) {
+    struct Bitboard bb;
+    struct Board b, ref, got;
+    uint8_t movable[MAX_PIECES];
+    int n, i, d, squares;
+    bool ok;
+    if (!bb_init(&bb, start)) return false;
+    b = *start;
+    ok = true;
+    for (n = 0; ok && n < positions; n++) {
+        bb_load(&bb, &b);
+        bb_store(&bb, &got);
+        ok = !memcmp(got.cell, b.cell, b.across * b.down);
+        for (d = LEFT; ok && d <= DOWN; d++) {
+            bb_movable(&bb, d, movable);
+            for (i = 0; ok && i < bb.num_pieces; i++) {
+                ok = bb_can_move(&bb, i, d) == can_move(&b, bb.id[i], d) && movable[i] == can_move(&b, bb.id[i], d);
+                ref = b;
+                if (ok && can_move(&ref, bb.id[i], d)) {
+                    move_one_piece(&ref, bb.id[i], d);
+                    bb_move_one(&bb, i, d);
+                    bb_store(&bb, &got);
+                    ok = !memcmp(got.cell, ref.cell, b.across * b.down);
+                    bb_move_back(&bb, i, d, 1);
+                }
+                ref = b;
+                squares = bb_click(&bb, i, d);
+                if (ok && (squares > 0) != click(&ref, bb.id[i], d)) ok = false;
+                bb_store(&bb, &got);
+                ok = ok && !memcmp(got.cell, ref.cell, b.across * b.down);
+                bb_move_back(&bb, i, d, squares);
+            }
+            if (!ok) {
+                fprintf(stderr, "%s: bitboard and rules.c differ for piece %u %s after %d random moves\n", filename,
+                    bb.id[i - 1], direction_names[d], n);
+            }
+        }
+        walk[n] = b;
+        random_click(&b, &bb);
+    }
+    bb_free(&bb);
+    return ok;
+}
+
+// every click from each position, as the breadth-first solver expands one (but without PUSH, which both use
+// slide_pieces() for)
+static double time_reference(const struct Board * walk, int positions, uint8_t * ids, int num_pieces) {
+    struct Board next;
+    double started, elapsed;
+    long expanded;
+    int i, d, n;
+    started = now();
+    expanded = 0;
+    do {
+        for (n = 0; n < positions; n++, expanded++) {
+            for (i = 0; i < num_pieces; i++) {
+                for (d = LEFT; d <= DOWN; d++) {
+                    next = walk[n];
+                    click(&next, ids[i], d);
+                }
+            }
+        }
+    } while ((elapsed = now() - started) < MIN_SECONDS);
+    return expanded / elapsed;
+}
+
+static double time_bitboard(struct Bitboard * bb, const struct Board * walk, int positions) {
+    uint8_t movable[MAX_PIECES];
+    double started, elapsed;
+    long expanded;
+    int i, d, n, squares;
+    started = now();
+    expanded = 0;
+    do {
+        for (n = 0; n < positions; n++, expanded++) {
+            bb_load(bb, &walk[n]);
+            for (d = LEFT; d <= DOWN; d++) {
+                bb_movable(bb, d, movable);
+                for (i = 0; i < bb->num_pieces; i++) {
+                    if (!movable[i]) continue;
+                    squares = bb_click(bb, i, d);
+                    bb_move_back(bb, i, d, squares);
+                }
+            }
+        }
+    } while ((elapsed = now() - started) < MIN_SECONDS);
+    return expanded / elapsed;
+}
+
+int main(int argc, char * argv[]) {
+    struct Puzzle p;
+    struct Board start, * walk;
+    struct Bitboard bb;
+    char err[160];
+    double ref_rate, bb_rate;
+    int opt, positions, status;
+
+    positions = DEFAULT_POSITIONS;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n': positions = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 0) | 1; break;
+            default: usage();
+        }
+    }
+    if (optind == argc || positions < 1) usage();
+    if (!(walk = malloc(positions * sizeof(struct Board)))) return 1;
+
+    status = 0;
+    for (; optind < argc; optind++) {
+        if (!puzz_read(argv[optind], &p, err, sizeof(err))) {
+            fprintf(stderr, "%s\n", err);
+            status = 1;
+            continue;
+        }
+        board_from_puzzle(&start, &p);
+        if (!check(argv[optind], &start, walk, positions)) {
+            status = 2;
+            continue;
+        }
+        if (!bb_init(&bb, &start)) return 1;
+        ref_rate = time_reference(walk, positions, bb.id, bb.num_pieces);
+        bb_rate = time_bitboard(&bb, walk, positions);
+        printf("%s %s: %dx%d, %d pieces, %u word%s: rules.c %.0f, bitboard %.0f positions expanded per second (x%.1f)\n",
+            argv[optind], p.name, p.squares_across, p.squares_down, bb.num_pieces, bb.words, bb.words > 1 ? "s" : "",
+            ref_rate, bb_rate, bb_rate / ref_rate);
+        bb_free(&bb);
+    }
+    free(walk);
+    return status;
+}
@@ -0,0 +1,72 @@
+// puzz_crop: rewrite ##.puzz files with only the part of the canvas that isn't background (**CROPPED**), so the
+// game reads less of each one
+// usage: puzz_crop [-u] file.puzz...
+// the background is the colour of the top left pixel: the rectangle kept is the smallest, with even left and
+// width, outside which every pixel is that colour, so nothing is lost. -u writes whole canvases again, for
+// builds of the game from before cropping. Solution tracks are kept
+
+#include "puzzfile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_crop [-u] file.puzz...\n"
+        "  -u  write the whole canvas (undo cropping)\n");
+    exit(1);
+}
+
+static bool rewrite(const char * filename, bool crop) {
+    struct Puzzle p, written;
+    struct PuzzMap map;
+    uint8_t canvas[CANVAS_SIZE], * moves = NULL;
+    long before;
+    int num_moves;
+    char err[160];
+    bool ok;
+    if (!puzz_map(filename, &p, &map, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return false;
+    }
+    // copied out of the mapping, which rewriting the file would pull from under them
+    memcpy(canvas, map.canvas, CANVAS_SIZE);
+    num_moves = p.solution_moves;
+    if (map.solution && !(moves = malloc(2 * num_moves + 1))) {
+        puzz_unmap(&map);
+        fprintf(stderr, "%s: out of memory\n", filename);
+        return false;
+    }
+    if (moves) memcpy(moves, map.solution, 2 * num_moves);
+    before = p.canvas_bytes;
+    puzz_unmap(&map);
+    ok = puzz_write(filename, &p, canvas, crop) && puzz_read(filename, &written, err, sizeof(err));
+    if (ok && moves) ok = puzz_write_solution(filename, &written, moves, num_moves);
+    free(moves);
+    if (!ok) {
+        fprintf(stderr, "%s: couldn't rewrite it\n", filename);
+        return false;
+    }
+    if (written.crop_width) {
+        printf("%s: canvas %ld bytes, was %ld (%d,%d %dx%d, background %u)\n", filename, written.canvas_bytes,
+            before, written.crop_left, written.crop_top, written.crop_width, written.crop_height, written.crop_colour);
+    } else {
+        printf("%s: canvas %ld bytes, was %ld\n", filename, written.canvas_bytes, before);
+    }
+    return true;
+}
+
+int main(int argc, char ** argv) {
+    bool crop = true, ok = true;
+    int opt, i;
+    while ((opt = getopt(argc, argv, "u")) != -1) {
+        switch (opt) {
+            case 'u': crop = false; break;
+            default: usage();
+        }
+    }
+    if (optind == argc) usage();
+    for (i = optind; i < argc; i++) {
+        if (!rewrite(argv[i], crop)) ok = false;
+    }
+    return ok ? 0 : 1;
+}
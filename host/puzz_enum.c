@@ -0,0 +1,500 @@
+// puzz_enum: count every position reachable from a puzzle's start, how far away the farthest ones are and, with
+// -g, how many moves each one needs to solve, on disk so that state spaces bigger than memory can be explored
+// usage: puzz_enum [-g] [-M megabytes] [-n positions] [-d directory] file.puzz
+// each breadth-first level is a sorted, front-coded file (see stateset.h) in the working directory. Successors are
+// sorted in memory-sized runs, then merged with the positions already seen. -g does the same backwards from the
+// solved positions, looking moves up in a sorted, memory-mapped file of every move. Progress is saved after each
+// level, and running the same command again carries on from the last level finished
+
+#include "stateset.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MEGABYTES 512 // for sorting runs
+#define DEFAULT_SHOW 3
+#define MAX_LEVELS 4096
+#define MAX_RUNS 100000
+#define PROGRESS_MAGIC "PUZZENUM1"
+
+struct Progress {
+    char start[2 * CODEC_MAX_BYTES + 1]; // the start position in hex, so another puzzle's files aren't reused
+    int levels; // level-N.set for the last level found, seen-N.set for every position up to it
+    int done;
+    uint64_t level_count[MAX_LEVELS];
+    int goal_levels; // goal-N.set for positions N moves from solved, solved-N.set for every one up to N
+    int goal_done;
+    uint64_t goal_count[MAX_LEVELS];
+    uint64_t unsolvable;
+};
+
+struct Enum {
+    struct Codec codec;
+    const char * dir;
+    struct Progress progress;
+    uint8_t * buffer; // records gathered for the next run
+    size_t buffered, capacity, buffer_size;
+    int record; // bytes per record: a position, or a (position, predecessor) pair for the goal search
+    int runs, next_run;
+    int run_id[MAX_RUNS];
+    const uint8_t * from; // the position being expanded
+    bool failed;
+};
+
+static int sort_bytes; // for compare(): qsort() has no context argument
+
+static int compare(const void * a, const void * b) {
+    return memcmp(a, b, sort_bytes);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_enum [-g] [-M megabytes] [-n positions] [-d directory] file.puzz\n"
+        "  -g  also find how many moves every position needs to solve, and the hardest ones\n"
+        "  -M  memory for sorting, in megabytes (default %d)\n"
+        "  -n  positions to print from the farthest level (default %d)\n"
+        "  -d  working directory, kept for resuming (default: file.puzz.enum)\n", DEFAULT_MEGABYTES, DEFAULT_SHOW);
+    exit(1);
+}
+
+static const char * file_name(const struct Enum * e, const char * kind, int n) {
+    static char path[2][4096];
+    static int which;
+    which ^= 1;
+    snprintf(path[which], sizeof(path[which]), "%s/%s-%04d.%s", e->dir, kind, n, strcmp(kind, "run") ? "set" : "tmp");
+    return path[which];
+}
+
+static bool save_progress(const struct Enum * e) {
+    const struct Progress * g = &e->progress;
+    char path[4096], temp[4096];
+    FILE * fp;
+    int i;
+    bool ok;
+    snprintf(path, sizeof(path), "%s/progress", e->dir);
+    snprintf(temp, sizeof(temp), "%s/progress.tmp", e->dir);
+    if (!(fp = fopen(temp, "w"))) return false;
+    fprintf(fp, "%s\n%s\n%d %d\n", PROGRESS_MAGIC, g->start, g->levels, g->done);
+    for (i = 0; i < g->levels; i++) fprintf(fp, "%llu\n", (unsigned long long)g->level_count[i]);
+    fprintf(fp, "%d %d %llu\n", g->goal_levels, g->goal_done, (unsigned long long)g->unsolvable);
+    for (i = 0; i < g->goal_levels; i++) fprintf(fp, "%llu\n", (unsigned long long)g->goal_count[i]);
+    ok = !ferror(fp);
+    ok = !fclose(fp) && ok;
+    return ok && !rename(temp, path);
+}
+
+static bool load_progress(struct Enum * e) {
+    struct Progress * g = &e->progress;
+    char path[4096], magic[16];
+    unsigned long long n;
+    FILE * fp;
+    int i;
+    bool ok;
+    snprintf(path, sizeof(path), "%s/progress", e->dir);
+    if (!(fp = fopen(path, "r"))) return false;
+    ok = fscanf(fp, "%15s %2048s %d %d", magic, g->start, &g->levels, &g->done) == 4 && !strcmp(magic, PROGRESS_MAGIC)
+        && g->levels > 0 && g->levels <= MAX_LEVELS;
+    for (i = 0; ok && i < g->levels; i++) {
+        ok = fscanf(fp, "%llu", &n) == 1;
+        g->level_count[i] = n;
+    }
+    ok = ok && fscanf(fp, "%d %d %llu", &g->goal_levels, &g->goal_done, &n) == 3 && g->goal_levels >= 0
+        && g->goal_levels <= MAX_LEVELS;
+    g->unsolvable = n;
+    for (i = 0; ok && i < g->goal_levels; i++) {
+        ok = fscanf(fp, "%llu", &n) == 1;
+        g->goal_count[i] = n;
+    }
+    fclose(fp);
+    return ok;
+}
+
+// a run or an interrupted level left over from a run that was stopped: the level is simply done again
+static void remove_temporary_files(const struct Enum * e) {
+    char path[4096];
+    struct dirent * entry;
+    size_t len;
+    DIR * dir;
+    if (!(dir = opendir(e->dir))) return;
+    while ((entry = readdir(dir))) {
+        len = strlen(entry->d_name);
+        if (len < 4 || strcmp(entry->d_name + len - 4, ".tmp")) continue;
+        snprintf(path, sizeof(path), "%s/%s", e->dir, entry->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+static bool flush_run(struct Enum * e) {
+    struct SetWriter w;
+    size_t i;
+    if (!e->buffered) return true;
+    if (e->runs == MAX_RUNS) return false;
+    sort_bytes = e->record;
+    qsort(e->buffer, e->buffered, e->record, compare);
+    e->run_id[e->runs] = e->next_run++;
+    if (!set_create(&w, file_name(e, "run", e->run_id[e->runs]), e->record)) return false;
+    e->runs++;
+    for (i = 0; i < e->buffered; i++) set_add(&w, e->buffer + i * e->record);
+    e->buffered = 0;
+    return set_finish(&w);
+}
+
+// merge the runs, SET_MERGE_WAYS at a time until one pass will do, then into out without anything in minus
+static bool merge_runs(struct Enum * e, const char * minus, const char * out, const char * with_minus,
+                       uint64_t * count) {
+    char names[SET_MERGE_WAYS][4096];
+    const char * inputs[SET_MERGE_WAYS];
+    int i, n, first, merged;
+    bool ok;
+    ok = true;
+    while (ok && e->runs > SET_MERGE_WAYS) {
+        for (first = merged = 0; ok && first < e->runs; first += n) {
+            n = e->runs - first < SET_MERGE_WAYS ? e->runs - first : SET_MERGE_WAYS;
+            for (i = 0; i < n; i++) {
+                snprintf(names[i], sizeof(names[i]), "%s", file_name(e, "run", e->run_id[first + i]));
+                inputs[i] = names[i];
+            }
+            e->run_id[merged] = e->next_run++;
+            ok = set_merge(inputs, n, NULL, file_name(e, "run", e->run_id[merged]), NULL, e->record, NULL);
+            merged++;
+            for (i = 0; i < n; i++) remove(names[i]);
+        }
+        e->runs = merged;
+    }
+    for (i = 0; i < e->runs; i++) {
+        snprintf(names[i], sizeof(names[i]), "%s", file_name(e, "run", e->run_id[i]));
+        inputs[i] = names[i];
+    }
+    ok = ok && set_merge(inputs, e->runs, minus, out, with_minus, e->record, count);
+    for (i = 0; i < e->runs; i++) remove(names[i]);
+    e->runs = 0;
+    return ok;
+}
+
+// a successor of e->from, followed by e->from itself if the records are pairs
+static bool gather(void * context, const struct Board * next, const uint8_t * state, uint16_t cell,
+                   uint8_t direction) {
+    struct Enum * e = context;
+    uint8_t * record;
+    (void)next;
+    (void)cell;
+    (void)direction;
+    if (e->buffered == e->capacity && !flush_run(e)) {
+        e->failed = true;
+        return false;
+    }
+    record = e->buffer + e->buffered++ * e->record;
+    memcpy(record, state, e->codec.state_bytes);
+    if (e->record > e->codec.state_bytes) memcpy(record + e->codec.state_bytes, e->from, e->codec.state_bytes);
+    return true;
+}
+
+// one breadth-first level: every successor of the last level that hasn't been seen before
+static bool forward_level(struct Enum * e) {
+    struct Progress * g = &e->progress;
+    struct SetReader r;
+    struct Board b;
+    char seen_before[4096], seen[4096], level[4096];
+    uint64_t count;
+    int d;
+    d = g->levels - 1;
+    if (!set_open(&r, file_name(e, "level", d), e->codec.state_bytes)) return false;
+    e->record = e->codec.state_bytes;
+    e->capacity = e->buffer_size / e->record;
+    e->failed = false;
+    while (!e->failed && set_next(&r)) {
+        codec_decode(&e->codec, r.state, &b);
+        codec_moves(&e->codec, &b, gather, e);
+    }
+    set_close(&r);
+    if (e->failed || r.error || !flush_run(e)) return false;
+    snprintf(seen_before, sizeof(seen_before), "%s", file_name(e, "seen", d));
+    snprintf(seen, sizeof(seen), "%s", file_name(e, "seen", d + 1));
+    snprintf(level, sizeof(level), "%s", file_name(e, "level", d + 1));
+    if (!merge_runs(e, seen_before, level, seen, &count)) return false;
+    if (!count) {
+        g->done = true;
+        remove(level);
+        remove(seen);
+        return save_progress(e);
+    }
+    if (g->levels == MAX_LEVELS) return false;
+    g->level_count[g->levels++] = count;
+    if (!save_progress(e)) return false;
+    remove(file_name(e, "level", d));
+    remove(seen_before);
+    return true;
+}
+
+// every move as a (position reached, position moved from) pair, sorted, in a plain file of fixed-size records
+// that can be memory-mapped and searched. Moves can't always be undone, so this is the only way to go backwards
+static bool build_moves(struct Enum * e) {
+    struct Progress * g = &e->progress;
+    struct SetReader r;
+    struct Board b;
+    char pairs[4096], path[4096], temp[4096];
+    FILE * fp;
+    bool ok;
+    if (!set_open(&r, file_name(e, "seen", g->levels - 1), e->codec.state_bytes)) return false;
+    e->record = 2 * e->codec.state_bytes;
+    e->capacity = e->buffer_size / e->record;
+    e->failed = false;
+    while (!e->failed && set_next(&r)) {
+        codec_decode(&e->codec, r.state, &b);
+        e->from = r.state;
+        codec_moves(&e->codec, &b, gather, e);
+    }
+    set_close(&r);
+    if (e->failed || r.error || !flush_run(e)) return false;
+    snprintf(pairs, sizeof(pairs), "%s/moves.tmp", e->dir);
+    snprintf(temp, sizeof(temp), "%s/moves-raw.tmp", e->dir);
+    snprintf(path, sizeof(path), "%s/moves.bin", e->dir);
+    if (!merge_runs(e, NULL, pairs, NULL, NULL) || !set_open(&r, pairs, e->record)) return false;
+    ok = (fp = fopen(temp, "wb")) != NULL;
+    while (ok && set_next(&r)) ok = fwrite(r.state, e->record, 1, fp) == 1;
+    set_close(&r);
+    remove(pairs);
+    ok = fp && !fclose(fp) && ok && !r.error;
+    return ok && !rename(temp, path);
+}
+
+// split the reachable positions into those already solved (goal-0, and solved-0 so far) and the rest
+static bool goal_start(struct Enum * e) {
+    struct Progress * g = &e->progress;
+    struct SetReader r;
+    struct SetWriter goal, solved;
+    struct Board b;
+    bool ok;
+    if (!build_moves(e) || !set_open(&r, file_name(e, "seen", g->levels - 1), e->codec.state_bytes)) return false;
+    ok = set_create(&goal, file_name(e, "goal", 0), e->codec.state_bytes);
+    ok = ok && set_create(&solved, file_name(e, "solved", 0), e->codec.state_bytes);
+    while (ok && set_next(&r)) {
+        codec_decode(&e->codec, r.state, &b);
+        if (!is_complete(&b, e->codec.goal)) continue;
+        set_add(&goal, r.state);
+        set_add(&solved, r.state);
+    }
+    set_close(&r);
+    ok = ok && !r.error && set_finish(&goal) && set_finish(&solved);
+    g->goal_count[0] = goal.count;
+    g->goal_levels = 1;
+    return ok && save_progress(e);
+}
+
+static uint64_t total_positions(const struct Progress * g) {
+    uint64_t total;
+    int i;
+    for (total = 0, i = 0; i < g->levels; i++) total += g->level_count[i];
+    return total;
+}
+
+// the positions one move further from solved: every position with a move into goal-k that isn't solved yet
+static bool goal_level(struct Enum * e) {
+    struct Progress * g = &e->progress;
+    struct SetReader r;
+    struct stat st;
+    const uint8_t * moves, * m;
+    char path[4096], solved_before[4096], solved[4096], goal[4096];
+    size_t count_moves, low, high, mid;
+    uint64_t count, total;
+    int fd, k;
+    bool ok;
+
+    k = g->goal_levels - 1;
+    snprintf(path, sizeof(path), "%s/moves.bin", e->dir);
+    if ((fd = open(path, O_RDONLY)) < 0) return false;
+    moves = fstat(fd, &st) || !st.st_size ? MAP_FAILED : mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (moves == MAP_FAILED) return false;
+    e->record = e->codec.state_bytes;
+    e->capacity = e->buffer_size / e->record;
+    count_moves = st.st_size / (2 * e->record);
+    ok = set_open(&r, file_name(e, "goal", k), e->record);
+    while (ok && set_next(&r)) {
+        // the first move reaching this position, then every position it can be reached from
+        for (low = 0, high = count_moves; low < high; ) {
+            mid = low + (high - low) / 2;
+            if (memcmp(moves + mid * 2 * e->record, r.state, e->record) < 0) low = mid + 1; else high = mid;
+        }
+        for (m = moves + low * 2 * e->record; low < count_moves && !memcmp(m, r.state, e->record); low++) {
+            if (e->buffered == e->capacity && !flush_run(e)) {
+                ok = false;
+                break;
+            }
+            memcpy(e->buffer + e->buffered++ * e->record, m + e->record, e->record);
+            m += 2 * e->record;
+        }
+    }
+    set_close(&r);
+    munmap((void *)moves, st.st_size);
+    if (!ok || r.error || !flush_run(e)) return false;
+
+    snprintf(solved_before, sizeof(solved_before), "%s", file_name(e, "solved", k));
+    snprintf(solved, sizeof(solved), "%s", file_name(e, "solved", k + 1));
+    snprintf(goal, sizeof(goal), "%s", file_name(e, "goal", k + 1));
+    if (!merge_runs(e, solved_before, goal, solved, &count)) return false;
+    if (!count) {
+        g->goal_done = true;
+        total = set_count(solved_before);
+        g->unsolvable = total_positions(g) - total;
+        remove(goal);
+        remove(solved);
+        remove(path); // moves.bin
+        return save_progress(e);
+    }
+    if (g->goal_levels == MAX_LEVELS) return false;
+    g->goal_count[g->goal_levels++] = count;
+    if (!save_progress(e)) return false;
+    remove(file_name(e, "goal", k));
+    remove(solved_before);
+    return true;
+}
+
+// as grid lines for a .puzz file, so any of them can be pasted in as a new start position
+static void print_positions(const struct Enum * e, const char * path, int show) {
+    struct SetReader r;
+    struct Board b;
+    uint8_t piece;
+    int row, col;
+    if (!set_open(&r, path, e->codec.state_bytes)) return;
+    while (show-- > 0 && set_next(&r)) {
+        codec_decode(&e->codec, r.state, &b);
+        printf("\n");
+        for (row = 0; row < b.down; row++) {
+            printf("    ");
+            for (col = 0; col < b.across; col++) {
+                piece = AT(&b, row, col);
+                printf("%u%s", piece && piece != WALL ? e->codec.original[piece] : piece, col + 1 < b.across ? "," : "\n");
+            }
+        }
+    }
+    set_close(&r);
+}
+
+static void report(const struct Enum * e, const char * filename, const struct Puzzle * p, bool goal, int show) {
+    const struct Progress * g = &e->progress;
+    uint64_t total;
+    int i;
+    total = total_positions(g);
+    printf("%s %s: %llu positions reachable from the start (slide mode %u)\n", filename, p->name,
+        (unsigned long long)total, p->slide);
+    printf("moves from start  positions\n");
+    for (i = 0; i < g->levels; i++) printf("%16d  %llu\n", i, (unsigned long long)g->level_count[i]);
+    printf("farthest from the start: %d moves (%llu positions)", g->levels - 1,
+        (unsigned long long)g->level_count[g->levels - 1]);
+    print_positions(e, file_name(e, "level", g->levels - 1), show);
+    if (!goal) return;
+    printf("\nmoves to solve  positions\n");
+    for (i = 0; i < g->goal_levels; i++) printf("%14d  %llu\n", i, (unsigned long long)g->goal_count[i]);
+    printf("can't be solved: %llu positions\n", (unsigned long long)g->unsolvable);
+    if (g->goal_levels && g->goal_count[g->goal_levels - 1]) {
+        printf("hardest starts: %d moves (%llu positions)", g->goal_levels - 1,
+            (unsigned long long)g->goal_count[g->goal_levels - 1]);
+        print_positions(e, file_name(e, "goal", g->goal_levels - 1), show);
+    }
+}
+
+int main(int argc, char * argv[]) {
+    struct Puzzle p;
+    struct Enum * e;
+    struct Board b;
+    struct SetWriter w;
+    char err[160], dir[4096], start[2 * CODEC_MAX_BYTES + 1];
+    uint8_t state[CODEC_MAX_BYTES];
+    unsigned long megabytes;
+    time_t started;
+    bool goal, ok;
+    int opt, show, i;
+
+    goal = false;
+    megabytes = DEFAULT_MEGABYTES;
+    show = DEFAULT_SHOW;
+    dir[0] = 0;
+    while ((opt = getopt(argc, argv, "gM:n:d:")) != -1) {
+        switch (opt) {
+            case 'g': goal = true; break;
+            case 'M': megabytes = strtoul(optarg, NULL, 0); break;
+            case 'n': show = atoi(optarg); break;
+            case 'd': snprintf(dir, sizeof(dir), "%s", optarg); break;
+            default: usage();
+        }
+    }
+    if (optind != argc - 1 || !megabytes) usage();
+    if (!puzz_read(argv[optind], &p, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    if (!dir[0]) snprintf(dir, sizeof(dir), "%s.enum", argv[optind]);
+    if (!(e = calloc(1, sizeof(*e))) || !codec_init(&e->codec, &p)) {
+        fprintf(stderr, "%s: %s\n", argv[optind], e ? "the goal wants a piece that isn't on the board" : "out of memory");
+        return 1;
+    }
+    e->dir = dir;
+    e->buffer_size = (size_t)megabytes * 1024 * 1024;
+    if (!(e->buffer = malloc(e->buffer_size))) {
+        fprintf(stderr, "can't allocate %lu megabytes\n", megabytes);
+        return 1;
+    }
+    b = e->codec.start;
+    codec_canonicalize(&e->codec, &b);
+    codec_encode(&e->codec, &b, state);
+    for (i = 0; i < e->codec.state_bytes; i++) sprintf(start + 2 * i, "%02x", state[i]);
+
+    mkdir(dir, 0777);
+    if (load_progress(e)) {
+        if (strcmp(e->progress.start, start)) {
+            fprintf(stderr, "%s holds the positions of a different puzzle or start\n", dir);
+            return 1;
+        }
+        if (!e->progress.done || (goal && !e->progress.goal_done)) {
+            fprintf(stderr, "carrying on from level %d in %s\n",
+                e->progress.done ? e->progress.goal_levels - 1 : e->progress.levels - 1, dir);
+        }
+    } else {
+        memset(&e->progress, 0, sizeof(e->progress));
+        strcpy(e->progress.start, start);
+        ok = set_create(&w, file_name(e, "level", 0), e->codec.state_bytes);
+        ok = ok && set_add(&w, state) && set_finish(&w);
+        ok = ok && set_create(&w, file_name(e, "seen", 0), e->codec.state_bytes);
+        ok = ok && set_add(&w, state) && set_finish(&w);
+        e->progress.levels = 1;
+        e->progress.level_count[0] = 1;
+        if (!ok || !save_progress(e)) {
+            fprintf(stderr, "can't write to %s\n", dir);
+            return 1;
+        }
+    }
+    remove_temporary_files(e);
+
+    ok = true;
+    while (ok && !e->progress.done) {
+        started = time(NULL);
+        ok = forward_level(e);
+        if (ok && !e->progress.done) {
+            fprintf(stderr, "level %d: %llu positions, %lds\n", e->progress.levels - 1,
+                (unsigned long long)e->progress.level_count[e->progress.levels - 1], (long)(time(NULL) - started));
+        }
+    }
+    if (ok && goal && !e->progress.goal_levels) ok = goal_start(e);
+    while (ok && goal && !e->progress.goal_done) {
+        started = time(NULL);
+        ok = goal_level(e);
+        if (ok && !e->progress.goal_done) {
+            fprintf(stderr, "%d moves to solve: %llu positions, %lds\n", e->progress.goal_levels - 1,
+                (unsigned long long)e->progress.goal_count[e->progress.goal_levels - 1], (long)(time(NULL) - started));
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: stopped: couldn't read or write the files in %s (out of disk space?)\n", argv[optind], dir);
+        return 1;
+    }
+    report(e, argv[optind], &p, goal, show);
+    free(e->buffer);
+    free(e);
+    return 0;
+}
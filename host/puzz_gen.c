@@ -0,0 +1,390 @@
+// puzz_gen: make a new start position for a puzzle, between min and max moves from its goal
+// usage: puzz_gen [-n min_moves] [-x max_moves] [-w walk] [-t tries] [-j threads] [-s seed] [-m max_states]
+//        template.puzz out.puzz
+// the goal, layout and picture come from template.puzz. When every position reachable from its start fits in
+// MAX_SPREAD, solve_spread() finds how far each one is from the goal and the new start is picked at random from
+// those in range. Otherwise each try starts from a solved position, or the farthest starts found so far (those
+// along the template's own solution among them), and undoes up to walk random moves; solve_bfs() then says how
+// many moves the start it reaches really needs. Tries run in parallel on all cores, and the first start in range
+// is written to out.puzz with the pieces of the picture moved to match, a "Can be done in N moves." instruction
+// and the solution as its track
+
+#include "solve.h"
+#include "canvas.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_MIN_MOVES 20
+#define DEFAULT_MAX_MOVES 30
+#define DEFAULT_TRIES 2000
+#define DEFAULT_MAX_STATES 5000000 // per try: every thread can hold one search this size at once
+#define MAX_SLIDE_BACK 8 // squares undone at most by one move back when pieces slide
+#define MAX_SPREAD 500000 // most positions to look at all at once, before walking instead
+#define MAX_BASES 16 // starts kept to walk from
+#define SHORT_WALK 3 // most steps taken from a base that isn't solved, three tries in four
+
+static const uint8_t opposite[5] = { NONE, RIGHT, DOWN, LEFT, UP };
+
+struct Base {
+    struct Board board;
+    int moves; // from the goal
+};
+
+struct Generator {
+    const struct Puzzle * template;
+    struct Board solved, template_start;
+    struct Base bases[MAX_BASES]; // the farthest starts found so far, shared by all the threads
+    int num_bases;
+    uint8_t ids[MAX_PIECES];
+    int num_pieces, min_moves, max_moves, walk, tries, next_try;
+    size_t max_states;
+    uint32_t seed;
+    pthread_mutex_t lock;
+    bool found;
+    struct Board start; // the winner, when found
+    struct Solution solution;
+    int out_of_range, failed; // tries rejected, for the summary
+};
+
+static uint32_t next_random(uint32_t * seed) { // xorshift32, seeded per try so each try repeats exactly
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_gen [-n min_moves] [-x max_moves] [-w walk] [-t tries] [-j threads] [-s seed] "
+        "[-m max_states] template.puzz out.puzz\n"
+        "  -n  fewest moves the new start may need (default %d)\n"
+        "  -x  most moves the new start may need (default %d)\n"
+        "  -w  most random moves undone per try (default max_moves)\n"
+        "  -t  give up after this many tries (default %d)\n"
+        "  -j  threads (default: one per core)\n"
+        "  -s  random seed\n"
+        "  -m  positions each solve may store (default %d)\n",
+        DEFAULT_MIN_MOVES, DEFAULT_MAX_MOVES, DEFAULT_TRIES, DEFAULT_MAX_STATES);
+    exit(1);
+}
+
+// a position that satisfies the goal: the goal itself when it places every piece, otherwise wherever the
+// template's own shortest solution ends. That solution is left in s when it was needed (s->moves is -1 if not)
+static bool solved_position(const struct Puzzle * p, size_t max_states, struct Board * b, struct Solution * s) {
+    int count[256], row, col, i;
+    bool whole;
+    memset(count, 0, sizeof(count));
+    for (row = 0; row < p->squares_down; row++) {
+        for (col = 0; col < p->squares_across; col++) {
+            count[p->grid[row][col]]++;
+            count[p->goal[row][col]]--;
+        }
+    }
+    for (whole = true, i = 1; whole && i < 256; i++) whole = !count[i];
+    board_from_puzzle(b, p);
+    memset(s, 0, sizeof(*s));
+    s->moves = -1;
+    if (whole) {
+        for (row = 0; row < p->squares_down; row++) memcpy(&AT(b, row, 0), p->goal[row], p->squares_across);
+        return true;
+    }
+    if (solve_bfs(p, max_states, s) < 0) return false;
+    for (i = 0; i < s->moves; i++) click(b, s->path[i].piece, s->path[i].direction);
+    return true;
+}
+
+// undo a random move: leave b where one click takes it back to where it was. With slide set, the click must
+// stop here, so the piece has to be up against something in the direction it will come back. Moving the last
+// piece straight back where it came from is skipped, or most walks would just undo themselves.
+// sliding puzzles have positions with no move into them except a PUSH, and positions with no way back by single
+// moves at all, so there half the steps are clicks forwards instead. Those can leave the goal out of
+// reach, which the solve afterwards catches
+static bool move_back(struct Generator * g, struct Board * b, uint32_t * seed, uint8_t * last, int * last_direction) {
+    uint8_t piece;
+    int direction, squares;
+    piece = g->ids[next_random(seed) % g->num_pieces];
+    direction = LEFT + next_random(seed) % 4; // the way the click will go
+    if (piece == *last && direction == *last_direction) return false;
+    if (b->slide && next_random(seed) % 2) { // sometimes a click forwards, PUSH included: see below
+        if (!click(b, piece, next_random(seed) % 5 ? direction : PUSH)) return false;
+        *last = 0;
+        return true;
+    }
+    if (!can_move(b, piece, opposite[direction])) return false;
+    if (b->slide && can_move(b, piece, direction)) return false;
+    squares = b->slide ? 1 + next_random(seed) % MAX_SLIDE_BACK : 1;
+    do {
+        move_one_piece(b, piece, opposite[direction]);
+    } while (--squares && can_move(b, piece, opposite[direction]));
+    *last = piece;
+    *last_direction = opposite[direction]; // a click that way would undo this one
+    return true;
+}
+
+// keep b to walk from if it's further from the goal than the nearest base kept, and not kept already. Call with
+// the lock held
+static void add_base(struct Generator * g, const struct Board * b, int moves) {
+    int i, nearest;
+    for (nearest = i = 0; i < g->num_bases; i++) {
+        if (!memcmp(g->bases[i].board.cell, b->cell, sizeof(b->cell))) return;
+        if (g->bases[i].moves < g->bases[nearest].moves) nearest = i;
+    }
+    if (g->num_bases < MAX_BASES) {
+        nearest = g->num_bases++;
+    } else if (moves < g->bases[nearest].moves) {
+        return;
+    }
+    g->bases[nearest].board = *b;
+    g->bases[nearest].moves = moves;
+}
+
+// without a spread, every try walks from one of the bases, the further of two picked at random, and a start it
+// reaches that's at least as far as the nearest base but still short of min_moves becomes a base in its place.
+// The bases start as the solved position and the positions along the template's own solution. Random walks
+// from the solved position alone mostly stay close to the goal, and with slide set they hardly ever get past the
+// middle distances
+static void * worker(void * arg) {
+    struct Generator * g;
+    struct Puzzle p;
+    struct Board b;
+    struct Solution s;
+    uint32_t seed;
+    int try, steps, attempts, row, i, j, last_direction, base_moves;
+    uint8_t last;
+    g = arg;
+    p = *g->template;
+    while (true) {
+        pthread_mutex_lock(&g->lock);
+        try = g->found || g->next_try >= g->tries ? -1 : g->next_try++;
+        if (try >= 0) {
+            seed = (g->seed ^ (uint32_t)try * 0x9E3779B9u) | 1;
+            i = next_random(&seed) % g->num_bases;
+            j = next_random(&seed) % g->num_bases;
+            if (g->bases[j].moves > g->bases[i].moves) i = j;
+            b = g->bases[i].board;
+            base_moves = g->bases[i].moves;
+        }
+        pthread_mutex_unlock(&g->lock);
+        if (try < 0) return NULL;
+        // mostly a step or two from a base that's got somewhere, so the walk doesn't throw that away
+        steps = 1 + next_random(&seed) % (base_moves && next_random(&seed) % 4 ? SHORT_WALK : g->walk);
+        last = 0;
+        last_direction = NONE;
+        for (attempts = 0; steps && attempts < 50 * g->walk; attempts++) {
+            if (move_back(g, &b, &seed, &last, &last_direction)) steps--;
+        }
+        for (row = 0; row < p.squares_down; row++) memcpy(p.grid[row], &AT(&b, row, 0), p.squares_across);
+        solve_bfs(&p, g->max_states, &s);
+        pthread_mutex_lock(&g->lock);
+        if (s.moves < 0) {
+            g->failed++;
+        } else if (s.moves < g->min_moves || s.moves > g->max_moves) {
+            if (s.moves < g->min_moves) add_base(g, &b, s.moves);
+            g->out_of_range++;
+        } else if (!memcmp(b.cell, g->template_start.cell, sizeof(b.cell))) {
+            g->out_of_range++; // nothing new
+        } else if (!g->found) {
+            g->found = true;
+            g->start = b;
+            g->solution = s;
+            s.path = NULL;
+        }
+        pthread_mutex_unlock(&g->lock);
+        solution_free(&s);
+    }
+}
+
+// when every position reachable from the template's start fits in max_states, the start is one of those in range,
+// picked at random, and no walking is needed. Returns the farthest any position is from the goal, or a SOLVE_
+// code: SOLVE_LIMIT when there are too many positions to look at them all
+static int pick_start(struct Generator * g, long * in_range, size_t * positions) {
+    struct Spread spread;
+    struct Puzzle p;
+    struct Board b;
+    uint32_t seed;
+    size_t i, pick;
+    int farthest, cell;
+    farthest = solve_spread(g->template, g->max_states < MAX_SPREAD ? g->max_states : MAX_SPREAD, &spread);
+    *positions = spread.count;
+    *in_range = 0;
+    if (farthest >= 0) {
+        for (i = 1; i < spread.count; i++) { // 0 is the template's own start
+            if (spread.moves[i] >= g->min_moves && spread.moves[i] <= g->max_moves) (*in_range)++;
+        }
+    }
+    if (*in_range) {
+        seed = g->seed | 1;
+        pick = ((uint64_t)next_random(&seed) << 32 | next_random(&seed)) % *in_range;
+        for (i = 1; spread.moves[i] < g->min_moves || spread.moves[i] > g->max_moves || pick--; i++) continue;
+        codec_decode(&spread.codec, spread.states + i * spread.codec.state_bytes, &b);
+        for (cell = 0; cell < b.across * b.down; cell++) {
+            if (b.cell[cell] && b.cell[cell] != WALL) b.cell[cell] = spread.codec.original[b.cell[cell]];
+        }
+        p = *g->template;
+        for (i = 0; i < p.squares_down; i++) memcpy(p.grid[i], &AT(&b, i, 0), p.squares_across);
+        if (solve_bfs(&p, g->max_states, &g->solution) >= 0) {
+            g->found = true;
+            g->start = b;
+        } else {
+            solution_free(&g->solution);
+            farthest = g->solution.moves;
+        }
+    }
+    spread_free(&spread);
+    return farthest;
+}
+
+// the instruction line that states the par, or failing that the first blank one (the last line if none is)
+static void set_claim(struct Puzzle * p, int moves) {
+    int i, line;
+    const char * c;
+    line = -1;
+    for (i = 0; line < 0 && i < 6; i++) {
+        for (c = p->instructions[i]; *c; c++) {
+            if (isdigit((unsigned char)*c) && strstr(c, "moves")) {
+                line = i;
+                break;
+            }
+        }
+    }
+    for (i = 0; line < 0 && i < 6; i++) {
+        if (!p->instructions[i][strspn(p->instructions[i], " ")]) line = i;
+    }
+    if (line < 0) line = 5;
+    snprintf(p->instructions[line], sizeof(p->instructions[line]), "Can be done in %d moves.", moves);
+}
+
+static bool write_puzzle(const char * filename, const struct Puzzle * template, const uint8_t * canvas,
+                         const struct Generator * g) {
+    struct Puzzle p, written;
+    uint8_t out[CANVAS_SIZE], * moves;
+    char err[160];
+    int row, i;
+    bool ok;
+    p = *template;
+    for (row = 0; row < p.squares_down; row++) memcpy(p.grid[row], &AT(&g->start, row, 0), p.squares_across);
+    p.start_moves = 0;
+    set_claim(&p, g->solution.moves);
+    canvas_move_pieces(&p, template->grid, p.grid, canvas, out);
+    if (!puzz_write(filename, &p, out, p.crop_width != 0) || // cropped if the template is
+        !puzz_read(filename, &written, err, sizeof(err))) return false;
+    if (!(moves = malloc(2 * g->solution.moves + 1))) return false;
+    for (i = 0; i < g->solution.moves; i++) {
+        moves[2 * i] = g->solution.path[i].piece;
+        moves[2 * i + 1] = g->solution.path[i].direction;
+    }
+    ok = puzz_write_solution(filename, &written, moves, g->solution.moves);
+    free(moves);
+    return ok;
+}
+
+int main(int argc, char * argv[]) {
+    struct Generator g;
+    struct Puzzle p;
+    pthread_t * threads;
+    struct PuzzMap map;
+    struct Solution own; // the template's
+    struct Board b;
+    char err[160];
+    int opt, i, row, col, num_threads, farthest;
+    long in_range;
+    size_t positions;
+    bool seen[256];
+
+    memset(&g, 0, sizeof(g));
+    g.min_moves = DEFAULT_MIN_MOVES;
+    g.max_moves = DEFAULT_MAX_MOVES;
+    g.tries = DEFAULT_TRIES;
+    g.max_states = DEFAULT_MAX_STATES;
+    g.seed = 2463534242u;
+    num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "n:x:w:t:j:s:m:")) != -1) {
+        switch (opt) {
+            case 'n': g.min_moves = atoi(optarg); break;
+            case 'x': g.max_moves = atoi(optarg); break;
+            case 'w': g.walk = atoi(optarg); break;
+            case 't': g.tries = atoi(optarg); break;
+            case 'j': num_threads = atoi(optarg); break;
+            case 's': g.seed = strtoul(optarg, NULL, 0); break;
+            case 'm': g.max_states = strtoul(optarg, NULL, 0); break;
+            default: usage();
+        }
+    }
+    if (argc - optind != 2 || g.min_moves < 1 || g.max_moves < g.min_moves) usage();
+    if (g.walk < 1) g.walk = g.max_moves;
+    if (num_threads < 1) num_threads = 1;
+
+    if (!puzz_map(argv[optind], &p, &map, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    g.template = &p;
+    if (!solved_position(&p, g.max_states, &g.solved, &own)) {
+        fprintf(stderr, "%s: couldn't find a solved position to walk back from\n", argv[optind]);
+        return 1;
+    }
+    memset(seen, 0, sizeof(seen));
+    for (row = 0; row < p.squares_down; row++) {
+        for (col = 0; col < p.squares_across; col++) {
+            if (p.grid[row][col] && p.grid[row][col] != WALL && !seen[p.grid[row][col]]) {
+                seen[p.grid[row][col]] = true;
+                g.ids[g.num_pieces++] = p.grid[row][col];
+            }
+        }
+    }
+    if (!g.num_pieces) usage();
+
+    farthest = pick_start(&g, &in_range, &positions);
+    if (farthest >= 0 && !g.found) {
+        fprintf(stderr, "%s: no start %d to %d moves from the goal: the farthest of its %zu positions is %d\n",
+            argv[optind], g.min_moves, g.max_moves, positions, farthest);
+        return 2;
+    }
+    if (g.found) {
+        if (!write_puzzle(argv[optind + 1], &p, map.canvas, &g)) {
+            fprintf(stderr, "%s: couldn't write the new puzzle\n", argv[optind + 1]);
+            return 1;
+        }
+        printf("%s: %d moves, one of %ld starts in range out of %zu positions\n", argv[optind + 1],
+            g.solution.moves, in_range, positions);
+        solution_free(&g.solution);
+        solution_free(&own);
+        puzz_unmap(&map);
+        return 0;
+    }
+
+    add_base(&g, &g.solved, 0);
+    board_from_puzzle(&g.template_start, &p);
+    if (own.moves < 0) solve_bfs(&p, g.max_states, &own);
+    // the template's solution passes a position at every distance short of its start's, and those that aren't
+    // past max_moves are bases: the farthest of them are kept, so walks start in or near the range however far
+    // out the template's own start is
+    b = g.template_start;
+    for (i = 0; i < own.moves; i++) {
+        if (own.moves - i <= g.max_moves) add_base(&g, &b, own.moves - i);
+        click(&b, own.path[i].piece, own.path[i].direction);
+    }
+    solution_free(&own);
+    pthread_mutex_init(&g.lock, NULL);
+    threads = malloc(num_threads * sizeof(pthread_t));
+    for (i = 0; i < num_threads; i++) pthread_create(&threads[i], NULL, worker, &g);
+    for (i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    if (!g.found) {
+        fprintf(stderr, "%s: no start %d to %d moves from the goal in %d tries (%d out of range, %d unsolved)\n",
+            argv[optind], g.min_moves, g.max_moves, g.next_try, g.out_of_range, g.failed);
+        return 2;
+    }
+    if (!write_puzzle(argv[optind + 1], &p, map.canvas, &g)) {
+        fprintf(stderr, "%s: couldn't write the new puzzle\n", argv[optind + 1]);
+        return 1;
+    }
+    printf("%s: %d moves, found after %d tries with %d threads\n", argv[optind + 1], g.solution.moves, g.next_try,
+        num_threads);
+    solution_free(&g.solution);
+    puzz_unmap(&map);
+    return 0;
+}
@@ -0,0 +1,406 @@
+// puzz_image: turn pictures into jigsaw puzzles, using an existing ##.puzz for the grid, goal and text
+// usage: puzz_image [-j threads] [-d dither] template.puzz image_directory output_directory
+// every .ppm (and .png, when built with libpng) in image_directory is scaled to the 320x240 canvas, given a
+// palette of 16 colours, dithered, cut into the template's squares as its goal lays them out, and written to
+// output_directory as name.puzz with the pieces at the template's start. Images are done in parallel on all
+// cores. Rename the results to ##.puzz to play them
+
+#include "canvas.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#ifdef HAVE_PNG
+#include <png.h>
+#endif
+
+#define DEFAULT_DITHER 24 // ordered dither spread, in 0-255 levels
+#define GRID_WEIGHT 4 // pixels on the pieces count this many times over the rest when choosing the palette
+#define KMEANS_PASSES 8
+#define PIXELS (CANVAS_WIDTH * CANVAS_HEIGHT)
+
+typedef float Vec16 __attribute__((vector_size(16 * sizeof(float)))); // one lane per palette entry
+
+struct Job {
+    char image[300], output[300];
+    bool ok;
+    char error[160];
+};
+
+struct Pool {
+    const struct Puzzle * template;
+    const uint8_t * template_canvas;
+    struct Job * jobs;
+    int num_jobs, next, dither;
+    pthread_mutex_t lock;
+};
+
+struct Bin { // one RGB555 colour of the image and how much of it there is
+    uint8_t c[3];
+    uint32_t weight;
+};
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_image [-j threads] [-d dither] template.puzz image_directory output_directory\n"
+        "  -j  threads (default: one per core)\n"
+        "  -d  ordered dither spread in 0-255 levels, 0 for none (default %d)\n"
+        "  images: .ppm%s\n", DEFAULT_DITHER,
+#ifdef HAVE_PNG
+        " and .png"
+#else
+        " (this build has no libpng)"
+#endif
+        );
+    exit(1);
+}
+
+static int ppm_int(FILE * fp) { // next number in a PPM header or P3 body, skipping # comments
+    int c, n;
+    while ((c = fgetc(fp)) == '#' || isspace(c)) {
+        if (c == '#') while ((c = fgetc(fp)) != '\n' && c != EOF) continue;
+    }
+    for (n = -1; isdigit(c); c = fgetc(fp)) n = (n < 0 ? 0 : n * 10) + c - '0';
+    return n;
+}
+
+static uint8_t * read_ppm(const char * filename, int * width, int * height) {
+    FILE * fp;
+    uint8_t * rgb;
+    char magic[2];
+    int maxval, i, n, v;
+    if (!(fp = fopen(filename, "rb"))) return NULL;
+    rgb = NULL;
+    if (fread(magic, 1, 2, fp) == 2 && magic[0] == 'P' && (magic[1] == '6' || magic[1] == '3')) {
+        *width = ppm_int(fp);
+        *height = ppm_int(fp);
+        maxval = ppm_int(fp);
+        n = *width * *height * 3;
+        if (*width > 0 && *height > 0 && maxval > 0 && maxval < 256 && (rgb = malloc(n))) {
+            if (magic[1] == '6') {
+                if (fread(rgb, 1, n, fp) != (size_t)n) n = -1;
+            } else {
+                for (i = 0; i < n && n > 0; i++) {
+                    if ((v = ppm_int(fp)) < 0 || v > maxval) n = -1;
+                    else rgb[i] = v * 255 / maxval;
+                }
+            }
+            if (n < 0) {
+                free(rgb);
+                rgb = NULL;
+            } else if (maxval != 255 && magic[1] == '6') {
+                for (i = 0; i < n; i++) rgb[i] = rgb[i] * 255 / maxval;
+            }
+        }
+    }
+    fclose(fp);
+    return rgb;
+}
+
+#ifdef HAVE_PNG
+static uint8_t * read_png(const char * filename, int * width, int * height) {
+    png_image image;
+    uint8_t * rgb;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, filename)) return NULL;
+    image.format = PNG_FORMAT_RGB;
+    if (!(rgb = malloc(PNG_IMAGE_SIZE(image))) || !png_image_finish_read(&image, NULL, rgb, 0, NULL)) {
+        png_image_free(&image);
+        free(rgb);
+        return NULL;
+    }
+    *width = image.width;
+    *height = image.height;
+    return rgb;
+}
+#endif
+
+static const char * extension(const char * name) {
+    const char * dot = strrchr(name, '.');
+    return dot ? dot + 1 : "";
+}
+
+static bool is_image(const char * name) {
+    if (!strcasecmp(extension(name), "ppm")) return true;
+#ifdef HAVE_PNG
+    if (!strcasecmp(extension(name), "png")) return true;
+#endif
+    return false;
+}
+
+// box filter each canvas pixel from its share of the image (or the nearest pixel when enlarging)
+static void scale(const uint8_t * rgb, int width, int height, float * out) {
+    int x, y, sx, sy, x0, x1, y0, y1, k;
+    float sum[3];
+    for (y = 0; y < CANVAS_HEIGHT; y++) {
+        y0 = y * height / CANVAS_HEIGHT;
+        y1 = (y + 1) * height / CANVAS_HEIGHT;
+        if (y1 <= y0) y1 = y0 + 1;
+        for (x = 0; x < CANVAS_WIDTH; x++) {
+            x0 = x * width / CANVAS_WIDTH;
+            x1 = (x + 1) * width / CANVAS_WIDTH;
+            if (x1 <= x0) x1 = x0 + 1;
+            sum[0] = sum[1] = sum[2] = 0;
+            for (sy = y0; sy < y1; sy++) {
+                for (sx = x0; sx < x1; sx++) {
+                    for (k = 0; k < 3; k++) sum[k] += rgb[(sy * width + sx) * 3 + k];
+                }
+            }
+            for (k = 0; k < 3; k++) out[(y * CANVAS_WIDTH + x) * 3 + k] = sum[k] / ((y1 - y0) * (x1 - x0));
+        }
+    }
+}
+
+// 1 for pixels on squares that hold a piece in the goal (where the picture is seen, and moves), else 0
+static void on_pieces(const struct Puzzle * p, uint8_t * mask) {
+    int row, col, x, y;
+    memset(mask, 0, PIXELS);
+    for (row = 0; row < p->squares_down; row++) {
+        for (col = 0; col < p->squares_across; col++) {
+            if (!p->goal[row][col] || p->goal[row][col] == WALL) continue;
+            for (y = 0; y < p->square_height; y++) {
+                for (x = 0; x < p->square_width; x++) {
+                    mask[(p->top_left_y + row * p->square_height + y) * CANVAS_WIDTH + p->top_left_x +
+                        col * p->square_width + x] = 1;
+                }
+            }
+        }
+    }
+}
+
+static int compare_channel;
+static int compare_bins(const void * a, const void * b) {
+    return ((const struct Bin *)a)->c[compare_channel] - ((const struct Bin *)b)->c[compare_channel];
+}
+
+// median cut of the weighted RGB555 histogram into up to 15 boxes, then k-means passes over the bins. Entry 0
+// stays black: it's the colour gfx_move() leaves behind a moved piece
+static void choose_palette(const float * image, const uint8_t * mask, float palette[16][3]) {
+    static __thread uint32_t histogram[32768];
+    struct Bin * bins;
+    int start[16], end[16], num_boxes, num_bins, i, j, k, box, channel, best, lo, hi;
+    uint64_t total, half, sum[16][4];
+    float d, best_d;
+    memset(histogram, 0, sizeof(histogram));
+    for (i = 0; i < PIXELS; i++) {
+        k = (int)image[3 * i] >> 3 | ((int)image[3 * i + 1] >> 3) << 5 | ((int)image[3 * i + 2] >> 3) << 10;
+        histogram[k] += mask[i] ? GRID_WEIGHT : 1;
+    }
+    bins = malloc(32768 * sizeof(struct Bin));
+    for (num_bins = k = 0; k < 32768; k++) {
+        if (!histogram[k]) continue;
+        bins[num_bins].c[0] = k & 31;
+        bins[num_bins].c[1] = k >> 5 & 31;
+        bins[num_bins].c[2] = k >> 10;
+        bins[num_bins++].weight = histogram[k];
+    }
+    start[0] = 0;
+    end[0] = num_bins;
+    for (num_boxes = 1; num_boxes < 15; num_boxes++) {
+        box = -1; // split the box with the widest channel, then at its weighted median
+        for (best = 0, i = 0; i < num_boxes; i++) {
+            if (end[i] - start[i] < 2) continue;
+            for (k = 0; k < 3; k++) {
+                for (lo = 31, hi = 0, j = start[i]; j < end[i]; j++) {
+                    if (bins[j].c[k] < lo) lo = bins[j].c[k];
+                    if (bins[j].c[k] > hi) hi = bins[j].c[k];
+                }
+                if (hi - lo > best) best = hi - lo, box = i, channel = k;
+            }
+        }
+        if (box < 0) break;
+        compare_channel = channel;
+        qsort(bins + start[box], end[box] - start[box], sizeof(struct Bin), compare_bins);
+        for (total = 0, j = start[box]; j < end[box]; j++) total += bins[j].weight;
+        for (half = 0, j = start[box]; j < end[box] - 1 && (half += bins[j].weight) < total / 2; j++) continue;
+        start[num_boxes] = j + 1;
+        end[num_boxes] = end[box];
+        end[box] = j + 1;
+    }
+    memset(sum, 0, sizeof(sum));
+    for (i = 0; i < num_boxes; i++) {
+        for (j = start[i]; j < end[i]; j++) {
+            for (k = 0; k < 3; k++) sum[i + 1][k] += (uint64_t)bins[j].c[k] * bins[j].weight;
+            sum[i + 1][3] += bins[j].weight;
+        }
+    }
+    for (i = 0; i < KMEANS_PASSES + 1; i++) {
+        memset(palette, 0, 16 * sizeof(palette[0]));
+        for (box = 1; box < 16; box++) {
+            for (k = 0; k < 3 && sum[box][3]; k++) palette[box][k] = (float)sum[box][k] / sum[box][3];
+        }
+        if (i == KMEANS_PASSES) break;
+        memset(sum, 0, sizeof(sum));
+        for (j = 0; j < num_bins; j++) {
+            for (best = 0, best_d = 1e9, box = 0; box < (num_boxes < 15 ? num_boxes + 1 : 16); box++) {
+                for (d = 0, k = 0; k < 3; k++) d += (bins[j].c[k] - palette[box][k]) * (bins[j].c[k] - palette[box][k]);
+                if (d < best_d) best_d = d, best = box;
+            }
+            if (!best) continue;
+            for (k = 0; k < 3; k++) sum[best][k] += (uint64_t)bins[j].c[k] * bins[j].weight;
+            sum[best][3] += bins[j].weight;
+        }
+    }
+    free(bins);
+    for (box = 0; box < 16; box++) { // to the 8-bit levels the RP6502 shows for each 5-bit value
+        for (k = 0; k < 3; k++) {
+            j = (int)(palette[box][k] + 0.5f);
+            palette[box][k] = j << 3 | j >> 2;
+        }
+    }
+}
+
+// 4x4 Bayer ordered dither, then the nearest palette entry. Each pixel is compared with all 16 entries at
+// once, one vector lane per entry, so the inner loop is a handful of SIMD multiply-adds
+static void dither(const float * image, float palette[16][3], int spread, uint8_t * canvas) {
+    static const uint8_t bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+    Vec16 pr, pg, pb, d;
+    float r, g, b, offset;
+    int x, y, i, best;
+    for (i = 0; i < 16; i++) {
+        pr[i] = palette[i][0];
+        pg[i] = palette[i][1];
+        pb[i] = palette[i][2];
+    }
+    for (y = 0; y < CANVAS_HEIGHT; y++) {
+        for (x = 0; x < CANVAS_WIDTH; x++) {
+            offset = ((bayer[y & 3][x & 3] + 0.5f) / 16 - 0.5f) * spread;
+            r = image[(y * CANVAS_WIDTH + x) * 3] + offset;
+            g = image[(y * CANVAS_WIDTH + x) * 3 + 1] + offset;
+            b = image[(y * CANVAS_WIDTH + x) * 3 + 2] + offset;
+            d = 2 * (pr - r) * (pr - r) + 4 * (pg - g) * (pg - g) + 3 * (pb - b) * (pb - b); // eye's weights
+            for (best = 0, i = 1; i < 16; i++) {
+                if (d[i] < d[best]) best = i;
+            }
+            canvas_set(canvas, x, y, best);
+        }
+    }
+}
+
+static bool run_job(struct Pool * pool, struct Job * job) {
+    struct Puzzle p;
+    uint8_t * rgb, * mask, goal_canvas[CANVAS_SIZE], canvas[CANVAS_SIZE];
+    float * image, palette[16][3];
+    uint16_t words[16];
+    const char * base;
+    int width, height, i;
+    rgb = !strcasecmp(extension(job->image), "ppm") ? read_ppm(job->image, &width, &height) : NULL;
+#ifdef HAVE_PNG
+    if (!strcasecmp(extension(job->image), "png")) rgb = read_png(job->image, &width, &height);
+#endif
+    if (!rgb) {
+        snprintf(job->error, sizeof(job->error), "couldn't read the image");
+        return false;
+    }
+    image = malloc(PIXELS * 3 * sizeof(float));
+    mask = malloc(PIXELS);
+    scale(rgb, width, height, image);
+    free(rgb);
+    p = *pool->template;
+    on_pieces(&p, mask);
+    choose_palette(image, mask, palette);
+    memcpy(goal_canvas, pool->template_canvas, CANVAS_SIZE);
+    dither(image, palette, pool->dither, goal_canvas);
+    for (i = 0; i < 16; i++) words[i] = PALETTE_WORD((int)palette[i][0], (int)palette[i][1], (int)palette[i][2]);
+    canvas_set_palette(goal_canvas, words);
+    free(image);
+    free(mask);
+    // the picture is drawn as the goal lays the pieces out: deal them out to the start
+    canvas_move_pieces(&p, p.goal, p.grid, goal_canvas, canvas);
+    base = strrchr(job->image, '/') ? strrchr(job->image, '/') + 1 : job->image;
+    snprintf(p.description, sizeof(p.description), "%.*s", (int)(extension(base) - base - 1), base);
+    if (!puzz_write(job->output, &p, canvas, p.crop_width != 0)) { // cropped if the template is
+        snprintf(job->error, sizeof(job->error), "couldn't write the puzzle");
+        return false;
+    }
+    return true;
+}
+
+static void * worker(void * arg) {
+    struct Pool * pool;
+    int i;
+    pool = arg;
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->num_jobs) return NULL;
+        pool->jobs[i].ok = run_job(pool, &pool->jobs[i]);
+    }
+}
+
+static int compare_jobs(const void * a, const void * b) {
+    return strcmp(((const struct Job *)a)->image, ((const struct Job *)b)->image);
+}
+
+int main(int argc, char * argv[]) {
+    struct Pool pool;
+    struct Puzzle template;
+    struct dirent * entry;
+    pthread_t * threads;
+    struct PuzzMap map;
+    char err[160];
+    DIR * d;
+    int opt, i, num_threads, failed;
+    size_t stem;
+
+    num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    pool.dither = DEFAULT_DITHER;
+    while ((opt = getopt(argc, argv, "j:d:")) != -1) {
+        switch (opt) {
+            case 'j': num_threads = atoi(optarg); break;
+            case 'd': pool.dither = atoi(optarg); break;
+            default: usage();
+        }
+    }
+    if (argc - optind != 3) usage();
+    if (!puzz_map(argv[optind], &template, &map, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    pool.template = &template;
+    pool.template_canvas = map.canvas;
+    if (!(d = opendir(argv[optind + 1]))) {
+        perror(argv[optind + 1]);
+        return 1;
+    }
+    pool.jobs = NULL;
+    pool.num_jobs = 0;
+    while ((entry = readdir(d))) {
+        if (!is_image(entry->d_name)) continue;
+        pool.jobs = realloc(pool.jobs, (pool.num_jobs + 1) * sizeof(struct Job));
+        memset(&pool.jobs[pool.num_jobs], 0, sizeof(struct Job));
+        snprintf(pool.jobs[pool.num_jobs].image, sizeof(pool.jobs[0].image), "%s/%s", argv[optind + 1],
+            entry->d_name);
+        stem = extension(entry->d_name) - entry->d_name - 1;
+        snprintf(pool.jobs[pool.num_jobs].output, sizeof(pool.jobs[0].output), "%s/%.*s.puzz", argv[optind + 2],
+            (int)stem, entry->d_name);
+        pool.num_jobs++;
+    }
+    closedir(d);
+    qsort(pool.jobs, pool.num_jobs, sizeof(struct Job), compare_jobs);
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > pool.num_jobs) num_threads = pool.num_jobs;
+    pool.next = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+    threads = malloc(num_threads * sizeof(pthread_t));
+    for (i = 0; i < num_threads; i++) pthread_create(&threads[i], NULL, worker, &pool);
+    for (i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+
+    for (failed = i = 0; i < pool.num_jobs; i++) {
+        if (pool.jobs[i].ok) {
+            printf("%s -> %s\n", pool.jobs[i].image, pool.jobs[i].output);
+        } else {
+            fprintf(stderr, "%s: %s\n", pool.jobs[i].image, pool.jobs[i].error);
+            failed++;
+        }
+    }
+    free(threads);
+    free(pool.jobs);
+    puzz_unmap(&map);
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,135 @@
+// puzz_session: list what happens in a ##.sess file recorded by a build of the game with -DPUZZ_SESSION=record
+// usage: puzz_session file.sess [file.puzz]
+// the pointer is followed the way mouse() in src/mouse.c follows it, from where the session starts it. Each left
+// click or drag, right button press (the menus going up) and release (a choice, if it's on one) and Shuffle seed is
+// listed with the frame it happened on; menu uses with the text cell under the pointer, as right_mouse_move() in
+// src/menu.c finds it. With the puzzle the session was recorded on, clicks and drags are given as board squares
+// too. A session written by a game that crashed stops at its last whole buffer
+
+#include "puzzfile.h"
+#include <stdlib.h>
+#include <string.h>
+
+// these mirror src/puzz.h and src/session.h, which can't be included on the host because they pull in <rp6502.h>
+#define MOUSE_DIV 4
+#define SESSION_MARK "PUZZ_SESSION_V1\n"
+#define SESSION_MARK_SIZE 16
+#define SESSION_RECORD 4
+#define SESSION_SEED 0xFF
+#define FRAME_RATE 60 // vsyncs a second
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_session file.sess [file.puzz]\n");
+    exit(1);
+}
+
+// the board square at screen coordinate (x, y), as board_square() in src/puzzle.c: false if it's off the board
+static bool board_square(const struct Puzzle * p, int x, int y, int * row, int * col) {
+    x -= p->top_left_x;
+    y -= p->top_left_y;
+    if (x < 0 || y < 0) return false;
+    x /= p->square_width;
+    y /= p->square_height;
+    if (x >= p->squares_across || y >= p->squares_down) return false;
+    *row = y;
+    *col = x;
+    return true;
+}
+
+static void print_place(const struct Puzzle * p, int x, int y) {
+    int row, col;
+    printf("(%d,%d)", x, y);
+    if (p && board_square(p, x, y, &row, &col)) printf(" square %d,%d", row, col);
+}
+
+// the text cell under (x, y), as right_mouse_move() finds it
+static void print_cell(const char * what, long frame, int x, int y) {
+    printf("%7ld  %s at (%d,%d), text cell %d,%d\n", frame, what, x, y, (x < 0 ? 0 : x) >> 3, (y < 0 ? 0 : y) >> 3);
+}
+
+// sx += the counter's change, kept on the canvas as mouse() keeps it
+static int follow(int s, int8_t change, int size) {
+    s += change;
+    if (s < -MOUSE_DIV) s = -MOUSE_DIV;
+    if (s > (size - 2) * MOUSE_DIV) s = (size - 2) * MOUSE_DIV;
+    return s;
+}
+
+int main(int argc, char ** argv) {
+    struct Puzzle puzzle, * p = NULL;
+    FILE * f;
+    uint8_t r[SESSION_RECORD], mb, changed, pressed, released;
+    char mark[SESSION_MARK_SIZE], err[160];
+    int sx, sy, x, y, press_x = 0, press_y = 0;
+    long frame = 0, press_frame = 0, records = 0, clicks = 0, drags = 0, menus = 0, seeds = 0;
+    if (argc < 2 || argc > 3 || argv[1][0] == '-') usage();
+    if (argc == 3) {
+        if (!puzz_read(argv[2], &puzzle, err, sizeof(err))) {
+            fprintf(stderr, "%s\n", err);
+            return 1;
+        }
+        p = &puzzle;
+    }
+    if (!(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (fread(mark, 1, SESSION_MARK_SIZE, f) != SESSION_MARK_SIZE || memcmp(mark, SESSION_MARK, SESSION_MARK_SIZE)) {
+        fprintf(stderr, "%s: not a session (no %.15s line)\n", argv[1], SESSION_MARK);
+        fclose(f);
+        return 1;
+    }
+    if (fread(r, 1, SESSION_RECORD, f) != SESSION_RECORD) {
+        fprintf(stderr, "%s: no start position\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    sx = (int16_t)(r[0] | r[1] << 8);
+    sy = (int16_t)(r[2] | r[3] << 8);
+    mb = fread(r, 1, SESSION_RECORD, f) == SESSION_RECORD ? r[0] : 0; // the counters themselves don't matter here
+    printf("start: pointer at (%d,%d)\n", sx / MOUSE_DIV, sy / MOUSE_DIV);
+    while (fread(r, 1, SESSION_RECORD, f) == SESSION_RECORD) {
+        records++;
+        frame += r[0];
+        if (r[3] == SESSION_SEED) {
+            printf("%7ld  shuffle seed %u\n", frame, r[1] | r[2] << 8);
+            seeds++;
+            continue;
+        }
+        sx = follow(sx, (int8_t)r[1], CANVAS_WIDTH);
+        sy = follow(sy, (int8_t)r[2], CANVAS_HEIGHT);
+        x = sx / MOUSE_DIV;
+        y = sy / MOUSE_DIV;
+        changed = mb ^ r[3];
+        pressed = r[3] & changed;
+        released = mb & changed;
+        mb = r[3];
+        if (pressed & 1) {
+            press_x = x;
+            press_y = y;
+            press_frame = frame;
+        } else if (released & 1) {
+            if (x == press_x && y == press_y) {
+                printf("%7ld  click ", frame);
+                clicks++;
+            } else {
+                printf("%7ld  drag ", press_frame);
+                print_place(p, press_x, press_y);
+                printf(" to ");
+                drags++;
+            }
+            print_place(p, x, y);
+            printf("\n");
+        }
+        if (pressed & 2) {
+            print_cell("menus up", frame, x, y);
+            menus++;
+        } else if (released & 2) {
+            print_cell("menus released", frame, x, y);
+        }
+    }
+    fclose(f);
+    printf("%ld records, %ld frames (%.1f seconds): %ld clicks, %ld drags, %ld menus, %ld shuffles\n", records, frame,
+        (double)frame / FRAME_RATE, clicks, drags, menus, seeds);
+    return 0;
+}
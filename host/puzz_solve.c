@@ -0,0 +1,137 @@
+// puzz_solve: find a shortest solution to ##.puzz puzzles, counting moves the way the Moves: counter does
+// usage: puzz_solve [-q] [-w] [-m max_states] [-p [-g group_tiles] [-P pdb_file]] file.puzz...
+// -p solves tile-style puzzles such as the 15 puzzle with IDA* and pattern databases, which are kept in
+// file.puzz.pdb (or pdb_file) and reused by later runs. If a shortest path takes more than max_states positions
+// expanded, it settles for a path that may be longer, and says how few moves it could take
+// -w writes the solution into the file as its solution track, for the game's Demo menu item
+
+#include "solve.h"
+#include "pdb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_MAX_STATES 50000000
+#define DEFAULT_MAX_NODES 5000000 // with -p: about 15 seconds
+
+static const char * solve_result(int moves) {
+    switch (moves) {
+        case SOLVE_UNSOLVABLE: return "unsolvable";
+        case SOLVE_LIMIT: return "state limit reached";
+        case SOLVE_NO_MEMORY: return "out of memory";
+        case SOLVE_REPLAY_FAILED: return "solution failed to replay";
+        default: return "solved";
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_solve [-q] [-w] [-m max_states] [-p [-g group_tiles] [-P pdb_file]] file.puzz...\n"
+        "  -q  print only the file name and minimum number of moves (par)\n"
+        "  -w  write the solution into the file as its solution track, for the Demo menu item\n"
+        "  -m  give up after this many distinct positions (default %u), or with -p, positions expanded\n"
+        "      looking for a shortest path before settling for any path (default %u)\n"
+        "  -p  tile puzzles: IDA* search with pattern databases instead of breadth-first search\n"
+        "  -g  tiles per pattern database group in slide modes 0 and 1 (default: largest in about 256 MB)\n"
+        "  -P  pattern database file (default: file.puzz.pdb)\n", DEFAULT_MAX_STATES, DEFAULT_MAX_NODES);
+    exit(1);
+}
+
+static bool solve_with_pdb(const char * filename, const struct Puzzle * p, const char * pdb_file, int group_tiles,
+                           size_t max_nodes, bool quiet, struct Solution * s) {
+    struct Pdb pdb;
+    char path[4096], why[80];
+    if (!pdb_supports(p, why, sizeof(why))) {
+        fprintf(stderr, "%s isn't a tile puzzle for -p: %s\n", filename, why);
+        return false;
+    }
+    snprintf(path, sizeof(path), "%s", pdb_file ? pdb_file : filename);
+    if (!pdb_file) strncat(path, ".pdb", sizeof(path) - strlen(path) - 1);
+    if (!pdb_open(&pdb, p, path, group_tiles, !quiet)) {
+        fprintf(stderr, "%s: couldn't build or read pattern databases in %s\n", filename, path);
+        return false;
+    }
+    solve_ida(p, &pdb, max_nodes, s);
+    pdb_close(&pdb);
+    return true;
+}
+
+static bool write_track(const char * filename, const struct Puzzle * p, const struct Solution * s) {
+    uint8_t * moves;
+    bool ok;
+    int i;
+    if (!(moves = malloc(2 * s->moves + 1))) return false;
+    for (i = 0; i < s->moves; i++) {
+        moves[2 * i] = s->path[i].piece;
+        moves[2 * i + 1] = s->path[i].direction;
+    }
+    ok = puzz_write_solution(filename, p, moves, s->moves);
+    free(moves);
+    if (!ok) fprintf(stderr, "%s: couldn't write the solution track\n", filename);
+    return ok;
+}
+
+int main(int argc, char * argv[]) {
+    struct Puzzle p;
+    struct Solution s;
+    struct SolveMove * m;
+    char err[160];
+    const char * pdb_file;
+    size_t max_states;
+    bool quiet, use_pdb, write;
+    int opt, i, status, group_tiles, drags;
+
+    quiet = use_pdb = write = false;
+    max_states = 0;
+    pdb_file = NULL;
+    group_tiles = 0;
+    while ((opt = getopt(argc, argv, "qwm:pg:P:")) != -1) {
+        switch (opt) {
+            case 'q': quiet = true; break;
+            case 'w': write = true; break;
+            case 'm': max_states = strtoul(optarg, NULL, 0); break;
+            case 'p': use_pdb = true; break;
+            case 'g': group_tiles = atoi(optarg); break;
+            case 'P': pdb_file = optarg; break;
+            default: usage();
+        }
+    }
+    if (optind == argc) usage();
+    if (!max_states) max_states = use_pdb ? DEFAULT_MAX_NODES : DEFAULT_MAX_STATES;
+
+    status = 0;
+    for (; optind < argc; optind++) {
+        if (!puzz_read(argv[optind], &p, err, sizeof(err))) {
+            fprintf(stderr, "%s\n", err);
+            status = 1;
+            continue;
+        }
+        if (use_pdb) {
+            if (!solve_with_pdb(argv[optind], &p, pdb_file, group_tiles, max_states, quiet, &s)) {
+                status = 1;
+                continue;
+            }
+        } else {
+            solve_bfs(&p, max_states, &s);
+        }
+        if (s.moves < 0) {
+            printf(quiet ? "%s -\n" : "%s %s: %s after %zu positions\n", argv[optind], p.name,
+                solve_result(s.moves), s.states);
+            status = status ? status : 2;
+        } else if (quiet) {
+            printf(s.at_least ? "%s %d (at least %d)\n" : "%s %d\n", argv[optind], s.moves, s.at_least);
+        } else {
+            drags = solution_drags(&p, &s);
+            printf("%s %s: %d moves (%zu positions %s, slide mode %u), %d of them drags\n", argv[optind], p.name,
+                s.moves, s.states, use_pdb ? "expanded" : "stored", p.slide, drags);
+            if (s.at_least) printf("  maybe not the fewest: a solution takes at least %d moves\n", s.at_least);
+            for (i = 0; i < s.moves; i++) {
+                m = &s.path[i];
+                printf("%4d  piece %3u at row %2u col %2u %s%s\n", i + 1, m->piece, m->row, m->col,
+                    direction_names[m->direction], m->drag ? " (drag: a click goes another way)" : "");
+            }
+        }
+        if (s.moves >= 0 && write && !write_track(argv[optind], &p, &s)) status = 1;
+        solution_free(&s);
+    }
+    return status;
+}
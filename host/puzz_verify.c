@@ -0,0 +1,263 @@
+// puzz_verify: check every ##.puzz file in a directory, in parallel on all cores, and write a JSON report
+// usage: puzz_verify [-j threads] [-m max_states] [-u] [directory]
+// for each puzzle: does it parse the way puzzle_load() parses it, does its geometry fit the 320x240 canvas and
+// the 40x30 text layer, is it solvable from its start position, and in how few moves. Tile puzzles are searched
+// as puzz_solve -p searches them, with pattern databases kept in ##.puzz.pdb. A puzzle whose search gives up
+// is reported as unknown, which fails the run unless -u is given
+
+#include "solve.h"
+#include "pdb.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MAX_STATES 5000000 // per puzzle: every thread can hold one search this size at once
+#define MAX_PROBLEMS 8
+
+#define RESULT_PASS 0
+#define RESULT_FAIL 1
+#define RESULT_UNKNOWN 2 // the search gave up
+
+static const char * const result_names[3] = { "pass", "fail", "unknown" };
+
+struct Job {
+    char filename[300];
+    struct Puzzle puzzle;
+    char error[160];
+    bool parsed;
+    const char * problems[MAX_PROBLEMS]; // geometry problems
+    int num_problems;
+    struct Solution solution;
+    bool tiles; // searched with IDA* and pattern databases
+    int claim; // from instructions such as "Can be done in 36 moves.", or -1
+    double seconds;
+};
+
+struct Pool {
+    struct Job * jobs;
+    int num_jobs, next;
+    size_t max_states;
+    pthread_mutex_t lock;
+};
+
+static void problem(struct Job * job, const char * text) {
+    if (job->num_problems < MAX_PROBLEMS) job->problems[job->num_problems++] = text;
+}
+
+// everything puzzle_load() and puzzle_click() trust the file to get right
+static void check_geometry(struct Job * job) {
+    struct Puzzle * p;
+    int row, col, squares;
+    bool in_goal[256], on_board[256];
+    p = &job->puzzle;
+    if (!p->square_width || !p->square_height) problem(job, "zero square size");
+    if (p->top_left_x < 0 || p->top_left_x + p->squares_across * p->square_width > CANVAS_WIDTH) {
+        problem(job, "grid is outside the canvas horizontally");
+    }
+    if (p->top_left_y < 0 || p->top_left_y + p->squares_down * p->square_height > CANVAS_HEIGHT) {
+        problem(job, "grid is outside the canvas vertically");
+    }
+    if (p->moves_row >= 30 || p->moves_col + 10 > 40) problem(job, "Moves: counter is off the 40x30 text layer");
+    if (p->moves_fg > 15 || p->moves_bg > 15) problem(job, "Moves: counter colour is not 0 to 15");
+    if (p->slide > 2) problem(job, "slide is not 0, 1 or 2");
+    memset(in_goal, 0, sizeof(in_goal));
+    memset(on_board, 0, sizeof(on_board));
+    squares = 0;
+    for (row = 0; row < p->squares_down; row++) {
+        for (col = 0; col < p->squares_across; col++) {
+            on_board[p->grid[row][col]] = true;
+            in_goal[p->goal[row][col]] = true;
+            if (p->grid[row][col] == 0) squares++;
+        }
+    }
+    if (!squares) problem(job, "no empty square to move into");
+    for (row = 1; row < WALL; row++) {
+        if (in_goal[row] && !on_board[row]) {
+            problem(job, "goal names a piece that isn't on the board");
+            break;
+        }
+    }
+}
+
+// a number followed by "moves" in the instructions, e.g. "Can be done in 36 moves."
+static int find_claim(const struct Puzzle * p) {
+    const char * c;
+    int i;
+    for (i = 0; i < 6; i++) {
+        for (c = p->instructions[i]; *c; c++) {
+            if (isdigit((unsigned char)*c) && (c == p->instructions[i] || !isdigit((unsigned char)c[-1]))) {
+                const char * end;
+                for (end = c; isdigit((unsigned char)*end); end++) continue;
+                while (*end == ' ') end++;
+                if (!strncmp(end, "moves", 5)) return atoi(c);
+            }
+        }
+    }
+    return -1;
+}
+
+// as puzz_solve -p: false if p isn't a tile puzzle, or its pattern databases can't be built or read
+static bool solve_tiles(struct Job * job, size_t max_nodes) {
+    struct Pdb pdb;
+    char path[sizeof(job->filename) + 4], why[80];
+    if (!pdb_supports(&job->puzzle, why, sizeof(why))) return false;
+    snprintf(path, sizeof(path), "%s.pdb", job->filename);
+    if (!pdb_open(&pdb, &job->puzzle, path, 0, false)) return false;
+    solve_ida(&job->puzzle, &pdb, max_nodes, &job->solution);
+    pdb_close(&pdb);
+    return true;
+}
+
+static void run_job(struct Job * job, size_t max_states) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    job->claim = -1;
+    job->solution.moves = SOLVE_UNSOLVABLE;
+    job->parsed = puzz_read(job->filename, &job->puzzle, job->error, sizeof(job->error));
+    if (job->parsed) {
+        check_geometry(job);
+        job->claim = find_claim(&job->puzzle);
+        job->tiles = solve_tiles(job, max_states);
+        if (!job->tiles) solve_bfs(&job->puzzle, max_states, &job->solution);
+        solution_free(&job->solution); // only the count is reported
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    job->seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void * worker(void * arg) {
+    struct Pool * pool;
+    int i;
+    pool = arg;
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->num_jobs) return NULL;
+        run_job(&pool->jobs[i], pool->max_states);
+    }
+}
+
+static bool is_puzz_name(const char * name) {
+    return isdigit((unsigned char)name[0]) && isdigit((unsigned char)name[1]) && !strcmp(name + 2, ".puzz");
+}
+
+static int compare_jobs(const void * a, const void * b) {
+    return strcmp(((const struct Job *)a)->filename, ((const struct Job *)b)->filename);
+}
+
+static void json_string(const char * s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+    putchar('"');
+}
+
+// returns the puzzle's result: RESULT_UNKNOWN when it's fine as far as the search got before giving up
+static int report_job(const struct Job * job, bool last) {
+    const struct Solution * s;
+    int i, result;
+    s = &job->solution;
+    result = !job->parsed || job->num_problems || s->moves == SOLVE_UNSOLVABLE ? RESULT_FAIL
+        : s->moves >= 0 ? RESULT_PASS : RESULT_UNKNOWN;
+    printf("  {\"file\": ");
+    json_string(strrchr(job->filename, '/') + 1);
+    printf(", \"result\": \"%s\", \"parsed\": %s", result_names[result], job->parsed ? "true" : "false");
+    if (!job->parsed) {
+        printf(", \"error\": ");
+        json_string(job->error);
+    } else {
+        printf(", \"name\": ");
+        json_string(job->puzzle.name);
+        printf(", \"grid\": [%u, %u], \"slide\": %u, \"geometry\": [",
+            job->puzzle.squares_across, job->puzzle.squares_down, job->puzzle.slide);
+        for (i = 0; i < job->num_problems; i++) {
+            if (i) printf(", ");
+            json_string(job->problems[i]);
+        }
+        printf("], \"solvable\": %s, \"min_moves\": ",
+            s->moves >= 0 ? "true" : s->moves == SOLVE_UNSOLVABLE ? "false" : "null");
+        if (s->moves >= 0 && !s->at_least) printf("%d", s->moves); else printf("null");
+        if (s->at_least) printf(", \"solution_moves\": %d, \"at_least\": %d", s->moves, s->at_least);
+        printf(", \"search\": \"%s\", \"positions\": %zu, \"claim\": ", job->tiles ? "ida" : "bfs", s->states);
+        if (job->claim >= 0) printf("%d", job->claim); else printf("null");
+    }
+    printf(", \"seconds\": %.3f}%s\n", job->seconds, last ? "" : ",");
+    return result;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: puzz_verify [-j threads] [-m max_states] [-u] [directory]\n"
+        "  -j  worker threads (default: one per core)\n"
+        "  -m  positions searched per puzzle before giving up (default %u)\n"
+        "  -u  a puzzle whose search gives up (unknown) doesn't fail the run\n", DEFAULT_MAX_STATES);
+    exit(1);
+}
+
+int main(int argc, char * argv[]) {
+    struct Pool pool;
+    pthread_t * threads;
+    struct dirent * entry;
+    const char * dir;
+    DIR * d;
+    bool allow_unknown;
+    int opt, i, num_threads, count[3];
+
+    num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    pool.max_states = DEFAULT_MAX_STATES;
+    allow_unknown = false;
+    while ((opt = getopt(argc, argv, "j:m:u")) != -1) {
+        switch (opt) {
+            case 'j': num_threads = atoi(optarg); break;
+            case 'm': pool.max_states = strtoul(optarg, NULL, 0); break;
+            case 'u': allow_unknown = true; break;
+            default: usage();
+        }
+    }
+    if (argc - optind > 1) usage();
+    dir = optind < argc ? argv[optind] : ".";
+
+    if (!(d = opendir(dir))) {
+        perror(dir);
+        return 1;
+    }
+    pool.jobs = NULL;
+    pool.num_jobs = 0;
+    while ((entry = readdir(d))) {
+        if (!is_puzz_name(entry->d_name)) continue;
+        pool.jobs = realloc(pool.jobs, (pool.num_jobs + 1) * sizeof(struct Job));
+        memset(&pool.jobs[pool.num_jobs], 0, sizeof(struct Job));
+        snprintf(pool.jobs[pool.num_jobs].filename, sizeof(pool.jobs[0].filename), "%s/%s", dir, entry->d_name);
+        pool.num_jobs++;
+    }
+    closedir(d);
+    qsort(pool.jobs, pool.num_jobs, sizeof(struct Job), compare_jobs);
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > pool.num_jobs) num_threads = pool.num_jobs;
+    pool.next = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+    threads = malloc(num_threads * sizeof(pthread_t));
+    for (i = 0; i < num_threads; i++) pthread_create(&threads[i], NULL, worker, &pool);
+    for (i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+
+    memset(count, 0, sizeof(count));
+    printf("{\"directory\": ");
+    json_string(dir);
+    printf(", \"threads\": %d, \"max_states\": %zu, \"puzzles\": [\n", num_threads, pool.max_states);
+    for (i = 0; i < pool.num_jobs; i++) {
+        count[report_job(&pool.jobs[i], i == pool.num_jobs - 1)]++;
+    }
+    printf("], \"passed\": %d, \"failed\": %d, \"unknown\": %d}\n", count[RESULT_PASS], count[RESULT_FAIL],
+        count[RESULT_UNKNOWN]);
+    free(threads);
+    free(pool.jobs);
+    return count[RESULT_FAIL] || (count[RESULT_UNKNOWN] && !allow_unknown) ? 2 : 0;
+}
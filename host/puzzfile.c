@@ -0,0 +1,334 @@
+// host-side ##.puzz reader and writer. Deliberately keeps the device's quirks (80-byte fgets lines, ; comments,
+// atoi/strtok parsing, the 11-byte chunked search for the canvas) so tools see exactly what puzzle_load() sees.
+// Files are memory-mapped and parsed where they lie: nothing bigger than a line is copied, except a cropped canvas,
+// which is filled out to the whole bitmap as puzzle_load() fills it
+
+#include "puzzfile.h"
+#include "canvas.h"
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Reader {
+    const uint8_t * data; // the mapped file
+    size_t size, pos;
+    const char * filename;
+    char line_buffer[MAX_LINE]; // one line at a time is copied, to be pruned the way read_line_n() does
+    char * err;
+    size_t err_size;
+};
+
+static bool fail(struct Reader * r, const char * format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(r->err, r->err_size, format, args);
+    va_end(args);
+    return false;
+}
+
+// fgets() on the mapping: up to MAX_LINE - 1 bytes, stopping after a linefeed. False at the end of the file
+static bool next_line(struct Reader * r) {
+    size_t n;
+    if (r->pos >= r->size) return false;
+    for (n = 0; n < MAX_LINE - 1 && r->pos < r->size; ) {
+        if ((r->line_buffer[n++] = r->data[r->pos++]) == '\n') break;
+    }
+    r->line_buffer[n] = '\0';
+    return true;
+}
+
+// the next byte, as fgetc() returns it
+static int next_byte(struct Reader * r) {
+    return r->pos < r->size ? r->data[r->pos++] : EOF;
+}
+
+// read_line_n() from src/puzzle.c: read a line, prune comment and trailing whitespace, check length >= n
+static bool read_line_n(struct Reader * r, uint8_t n) {
+    char * c;
+    if (!next_line(r)) {
+        return fail(r, "Unexpected EOF reading %s", r->filename);
+    }
+    c = strchr(r->line_buffer, ';');
+    if (c) *c = '\0';
+    c = r->line_buffer + strlen(r->line_buffer) - 1;
+    while (c > r->line_buffer && strchr(" \n\r\t", *c)) *c-- = '\0';
+    if (strlen(r->line_buffer) < n) {
+        return fail(r, "Line in %s too short: %s", r->filename, r->line_buffer);
+    }
+    return true;
+}
+
+static bool read_int(struct Reader * r, int * value) {
+    if (!read_line_n(r, 1)) return false;
+    *value = atoi(r->line_buffer);
+    return true;
+}
+
+static bool read_u8(struct Reader * r, uint8_t * value) {
+    int i;
+    if (!read_int(r, &i)) return false;
+    *value = (uint8_t)i;
+    return true;
+}
+
+static bool read_rows(struct Reader * r, struct Puzzle * p, uint8_t g[MAX_DOWN][MAX_ACROSS]) {
+    uint8_t i, j;
+    char * token;
+    for (i = 0; i < p->squares_down; i++) {
+        if (!read_line_n(r, p->squares_across + p->squares_across - 1)) return false;
+        for (j = 0; j < p->squares_across; j++) {
+            token = strtok(j ? NULL : r->line_buffer, " ,");
+            if (!token) return fail(r, "Row %u of %s has fewer than %u values", i, r->filename, p->squares_across);
+            g[i][j] = (uint8_t)atoi(token);
+        }
+    }
+    return true;
+}
+
+// demo_find() in src/demo.c: the mark straight after the palette, then digits up to a linefeed
+static bool find_solution(struct Reader * r, struct Puzzle * p, struct PuzzMap * map) {
+    int c;
+    r->pos = p->canvas_offset + p->canvas_bytes;
+    if (r->size - r->pos < SOLUTION_MARK_SIZE || memcmp(r->data + r->pos, SOLUTION_MARK, SOLUTION_MARK_SIZE)) {
+        return true; // no track
+    }
+    r->pos += SOLUTION_MARK_SIZE;
+    while ((c = next_byte(r)) != EOF && c != '\n') {
+        if (c >= '0' && c <= '9') p->solution_moves = p->solution_moves * 10 + c - '0';
+    }
+    p->solution_offset = r->pos;
+    if (c == EOF || p->file_size - p->solution_offset < 2L * p->solution_moves) {
+        return fail(r, "%s solution track is %ld bytes, expected %d", r->filename,
+            c == EOF ? 0L : p->file_size - p->solution_offset, 2 * p->solution_moves);
+    }
+    map->solution = r->data + p->solution_offset;
+    return true;
+}
+
+// read_canvas() in src/puzzle.c: colour around the rectangle, the rows in it, then the palette
+static bool fill_canvas(const struct Puzzle * p, struct PuzzMap * map) {
+    const uint8_t * rows = map->canvas;
+    int y, row_bytes = p->crop_width / 2;
+    if (!(map->filled = malloc(CANVAS_SIZE))) return false;
+    memset(map->filled, p->crop_colour | p->crop_colour << 4, BITMAP_SIZE);
+    for (y = 0; y < p->crop_height; y++) {
+        memcpy(map->filled + (p->crop_top + y) * CANVAS_STRIDE + p->crop_left / 2, rows + y * row_bytes, row_bytes);
+    }
+    memcpy(map->filled + BITMAP_SIZE, rows + p->crop_height * row_bytes, PALETTE_SIZE);
+    map->canvas = map->filled;
+    return true;
+}
+
+// the next number on a **CROPPED** line, or -1 if there isn't one, as crop_value() in src/puzzle.c
+static int crop_value(char * s) {
+    s = strtok(s, " ,");
+    return s ? atoi(s) : -1;
+}
+
+static bool read_crop(struct Reader * r, struct Puzzle * p) {
+    int colour;
+    p->crop_left = crop_value(r->line_buffer + CROP_MARK_SIZE);
+    p->crop_top = crop_value(NULL);
+    p->crop_width = crop_value(NULL);
+    p->crop_height = crop_value(NULL);
+    colour = crop_value(NULL);
+    if (p->crop_left < 0 || p->crop_left & 0x01 || p->crop_width <= 0 || p->crop_width & 0x01 ||
+        p->crop_left + p->crop_width > CANVAS_WIDTH || p->crop_top < 0 || p->crop_height <= 0 ||
+        p->crop_top + p->crop_height > CANVAS_HEIGHT || colour < 0 || colour > 15) {
+        p->crop_width = 0;
+        return fail(r, "%s bad %s rectangle", r->filename, CROP_MARK);
+    }
+    p->crop_colour = colour;
+    return true;
+}
+
+// the device reads 11 bytes at a time until it has seen 2 * squares_down + 21 linefeeds, then reads up to the
+// next linefeed. The bitmap starts straight after that
+static bool find_canvas(struct Reader * r, struct Puzzle * p, struct PuzzMap * map) {
+    const uint8_t * chunk;
+    int i, c;
+    size_t k;
+    r->pos = 0;
+    i = 0;
+    while (i < 2 * p->squares_down + 21) {
+        if (r->size - r->pos < 11) {
+            return fail(r, "Error searching for **CANVAS** in %s", r->filename);
+        }
+        chunk = r->data + r->pos;
+        r->pos += 11;
+        for (k = 0; k < 11 && chunk[k]; k++) {
+            if (chunk[k] == '\n') i++;
+        }
+    }
+    do {
+        c = next_byte(r);
+    } while (c != '\n' && c != EOF);
+    p->canvas_offset = r->pos;
+    p->file_size = r->size;
+    p->canvas_bytes = p->crop_width ? (long)p->crop_width / 2 * p->crop_height + PALETTE_SIZE : CANVAS_SIZE;
+    if (c == EOF || p->file_size - p->canvas_offset < p->canvas_bytes) {
+        return fail(r, "%s canvas is %ld bytes, expected %ld", r->filename,
+            c == EOF ? 0L : p->file_size - p->canvas_offset, p->canvas_bytes);
+    }
+    map->canvas = r->data + p->canvas_offset;
+    if (p->crop_width && !fill_canvas(p, map)) return fail(r, "Out of memory reading %s", r->filename);
+    map->palette = map->canvas + BITMAP_SIZE;
+    return find_solution(r, p, map);
+}
+
+static bool read_puzzle(struct Reader * r, struct Puzzle * p, struct PuzzMap * map) {
+    uint8_t i;
+    if (!read_line_n(r, 16)) return false;
+    if (strncmp(r->line_buffer, "PUZZ_RP6502_V", 13)) {
+        return fail(r, "%s missing PUZZ_RP6502_V identifier", r->filename);
+    }
+    strcpy(p->identifier, r->line_buffer);
+    if (!read_line_n(r, 1)) return false;
+    snprintf(p->name, sizeof(p->name), "%.13s", r->line_buffer);
+    if (!read_line_n(r, 1)) return false;
+    strcpy(p->description, r->line_buffer);
+    if (!read_int(r, &p->start_moves)) return false;
+    for (i = 0; i < 6; i++) {
+        if (!read_line_n(r, 0)) return false;
+        snprintf(p->instructions[i], sizeof(p->instructions[i]), "%.26s", r->line_buffer);
+    }
+    if (!read_u8(r, &p->squares_across) || !read_u8(r, &p->squares_down)) return false;
+    if (!p->squares_across || p->squares_across > MAX_ACROSS || !p->squares_down || p->squares_down > MAX_DOWN) {
+        return fail(r, "%s grid %u x %u is outside 1 x 1 to %u x %u", r->filename,
+            p->squares_across, p->squares_down, MAX_ACROSS, MAX_DOWN);
+    }
+    if (!read_rows(r, p, p->grid) || !read_rows(r, p, p->goal)) return false;
+    if (!read_int(r, &p->top_left_x) || !read_int(r, &p->top_left_y)) return false;
+    if (!read_u8(r, &p->square_width) || !read_u8(r, &p->square_height) || !read_u8(r, &p->slide)) return false;
+    if (!read_u8(r, &p->moves_col) || !read_u8(r, &p->moves_row)) return false;
+    if (!read_u8(r, &p->moves_fg) || !read_u8(r, &p->moves_bg)) return false;
+    if (!read_line_n(r, 10)) return false;
+    if (!strncmp(r->line_buffer, CROP_MARK, CROP_MARK_SIZE)) {
+        if (!read_crop(r, p)) return false;
+    } else if (strncmp(r->line_buffer, "**CANVAS**", 10)) {
+        return fail(r, "%s missing **CANVAS** identifier", r->filename);
+    }
+    return find_canvas(r, p, map);
+}
+
+bool puzz_map(const char * filename, struct Puzzle * p, struct PuzzMap * map, char * err, size_t err_size) {
+    struct Reader r;
+    struct stat st;
+    void * data;
+    int fd;
+    memset(p, 0, sizeof(*p));
+    memset(map, 0, sizeof(*map));
+    memset(&r, 0, sizeof(r));
+    r.filename = filename;
+    r.err = err;
+    r.err_size = err_size;
+    if ((fd = open(filename, O_RDONLY)) < 0) {
+        return fail(&r, "File not found error: %s", filename);
+    }
+    if (fstat(fd, &st)) {
+        close(fd);
+        return fail(&r, "Couldn't read %s", filename);
+    }
+    if (st.st_size) { // an empty file can't be mapped: it fails as an early EOF
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return fail(&r, "Couldn't map %s", filename);
+        }
+        map->data = data;
+        map->size = st.st_size;
+    }
+    close(fd);
+    r.data = map->data;
+    r.size = map->size;
+    if (!read_puzzle(&r, p, map)) {
+        puzz_unmap(map);
+        return false;
+    }
+    return true;
+}
+
+void puzz_unmap(struct PuzzMap * map) {
+    if (map->data) munmap((void *)map->data, map->size);
+    free(map->filled);
+    memset(map, 0, sizeof(*map));
+}
+
+bool puzz_read(const char * filename, struct Puzzle * p, char * err, size_t err_size) {
+    struct PuzzMap map;
+    if (!puzz_map(filename, p, &map, err, err_size)) return false;
+    puzz_unmap(&map);
+    return true;
+}
+
+bool puzz_write_solution(const char * filename, const struct Puzzle * p, const uint8_t * moves, int num_moves) {
+    FILE * fp;
+    bool ok;
+    if (!(fp = fopen(filename, "r+b"))) return false;
+    ok = !ftruncate(fileno(fp), p->canvas_offset + p->canvas_bytes) && !fseek(fp, 0, SEEK_END);
+    ok = ok && fprintf(fp, "%s%d\n", SOLUTION_MARK, num_moves) > 0;
+    ok = ok && fwrite(moves, 2, num_moves, fp) == (size_t)num_moves;
+    return !fclose(fp) && ok;
+}
+
+static void write_rows(FILE * fp, const struct Puzzle * p, const uint8_t g[MAX_DOWN][MAX_ACROSS]) {
+    int i, j;
+    for (i = 0; i < p->squares_down; i++) {
+        for (j = 0; j < p->squares_across; j++) {
+            fprintf(fp, "%u%c", g[i][j], j == p->squares_across - 1 ? '\n' : ',');
+        }
+    }
+}
+
+// the smallest rectangle, with even left and width, outside which every pixel is the colour of the top left
+// one. False if that's the whole canvas
+static bool find_crop(const uint8_t * canvas, int * left, int * top, int * right, int * bottom, uint8_t * colour) {
+    int x, y;
+    *colour = canvas_get(canvas, 0, 0);
+    *left = CANVAS_WIDTH, *top = CANVAS_HEIGHT, *right = *bottom = -1;
+    for (y = 0; y < CANVAS_HEIGHT; y++) {
+        for (x = 0; x < CANVAS_WIDTH; x++) {
+            if (canvas_get(canvas, x, y) == *colour) continue;
+            if (x < *left) *left = x;
+            if (x > *right) *right = x;
+            if (y < *top) *top = y;
+            *bottom = y;
+        }
+    }
+    if (*right < 0) *left = *top = *right = *bottom = 0; // all one colour: keep a pixel pair
+    *left &= ~1;
+    *right |= 1;
+    return *right - *left + 1 < CANVAS_WIDTH || *bottom - *top + 1 < CANVAS_HEIGHT;
+}
+
+bool puzz_write(const char * filename, const struct Puzzle * p, const uint8_t * canvas, bool crop) {
+    FILE * fp;
+    bool ok;
+    int i, y, left, top, right, bottom;
+    uint8_t colour;
+    if (!(fp = fopen(filename, "wb"))) return false;
+    fprintf(fp, "%s\n%s\n%s\n%d\n", p->identifier, p->name, p->description, p->start_moves);
+    for (i = 0; i < 6; i++) {
+        fprintf(fp, "%s\n", p->instructions[i]);
+    }
+    fprintf(fp, "%u\n%u\n", p->squares_across, p->squares_down);
+    write_rows(fp, p, p->grid);
+    write_rows(fp, p, p->goal);
+    fprintf(fp, "%d\n%d\n%u\n%u\n", p->top_left_x, p->top_left_y, p->square_width, p->square_height);
+    fprintf(fp, "%u\n%u\n%u\n%u\n%u\n", p->slide, p->moves_col, p->moves_row, p->moves_fg, p->moves_bg);
+    if (crop && find_crop(canvas, &left, &top, &right, &bottom, &colour)) {
+        fprintf(fp, "%s %d %d %d %d %u\n", CROP_MARK, left, top, right - left + 1, bottom - top + 1, colour);
+        for (y = top; y <= bottom; y++) {
+            fwrite(canvas + y * CANVAS_STRIDE + left / 2, 1, (right - left + 1) / 2, fp);
+        }
+        ok = fwrite(canvas + BITMAP_SIZE, 1, PALETTE_SIZE, fp) == PALETTE_SIZE && !ferror(fp);
+    } else {
+        fputs("**CANVAS**\n", fp);
+        ok = fwrite(canvas, 1, CANVAS_SIZE, fp) == CANVAS_SIZE && !ferror(fp);
+    }
+    return !fclose(fp) && ok;
+}
@@ -0,0 +1,70 @@
+#ifndef _PUZZFILE_
+    // host-side reader and writer for ##.puzz files, following puzzle_load() and puzzle_save() in src/puzzle.c
+    // line for line. Every tool reads and writes them through here
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <stdio.h>
+
+    // these mirror src/puzz.h, which can't be included on the host because it pulls in <rp6502.h>
+    #define CANVAS_WIDTH 320
+    #define CANVAS_HEIGHT 240
+    #define BITMAP_SIZE (CANVAS_WIDTH / 2 * CANVAS_HEIGHT)
+    #define PALETTE_SIZE 0x0020
+    #define CANVAS_SIZE (BITMAP_SIZE + PALETTE_SIZE) // bytes after **CANVAS** read by puzzle_load()
+    // a cropped canvas, as src/puzzle.h: this mark then "left top width height colour" on the line in place of
+    // **CANVAS**, then that rectangle's rows (width / 2 bytes each) and the palette. The rest of the bitmap is colour
+    #define CROP_MARK "**CROPPED**"
+    #define CROP_MARK_SIZE 11
+    // optional solution track after the canvas, played by the Demo menu item (src/demo.c): this line, a line
+    // with the number of moves, then two bytes per move: piece and direction (LEFT to DOWN, or PUSH)
+    #define SOLUTION_MARK "**SOLUTION**\n"
+    #define SOLUTION_MARK_SIZE 13
+    #define MAX_LINE 80
+    #define MAX_ACROSS 32
+    #define MAX_DOWN 32
+    #define MAX_PIECES 255
+    #define WALL 255
+
+    struct Puzzle {
+        char identifier[MAX_LINE];
+        char name[14], description[MAX_LINE];
+        int start_moves;
+        char instructions[6][27];
+        uint8_t squares_across, squares_down;
+        uint8_t grid[MAX_DOWN][MAX_ACROSS];
+        uint8_t goal[MAX_DOWN][MAX_ACROSS];
+        int top_left_x, top_left_y;
+        uint8_t square_width, square_height, slide, moves_col, moves_row, moves_fg, moves_bg;
+        long canvas_offset; // file offset of the bitmap data, found the same way puzzle_load() finds it
+        long canvas_bytes; // in the file: CANVAS_SIZE, or less for a cropped canvas
+        int crop_left, crop_top, crop_width, crop_height; // crop_width 0 for a whole canvas
+        uint8_t crop_colour;
+        long file_size;
+        long solution_offset; // file offset of the solution track's first move, 0 if there's no track
+        int solution_moves;
+    };
+
+    // a file mapped read-only into memory, with views of the parts after the header where they lie in it
+    struct PuzzMap {
+        const uint8_t * data;
+        size_t size;
+        const uint8_t * canvas; // CANVAS_SIZE bytes: the bitmap, then the palette
+        const uint8_t * palette; // 16 palette words, little-endian
+        const uint8_t * solution; // solution_moves (piece, direction) pairs, or NULL if there's no track
+        uint8_t * filled; // a cropped canvas, filled out to the whole bitmap: canvas points here
+    };
+
+    // returns true on success. On failure, err holds a message in the style of the device's error messages
+    bool puzz_read(const char * filename, struct Puzzle * p, char * err, size_t err_size);
+    // puzz_read() that keeps the file mapped, for the canvas and solution track: puzz_unmap() when done with them.
+    // On failure there's nothing to unmap
+    bool puzz_map(const char * filename, struct Puzzle * p, struct PuzzMap * map, char * err, size_t err_size);
+    void puzz_unmap(struct PuzzMap * map);
+    // write p and canvas as a new file, laid out the way puzzle_save() writes one. With crop, only the smallest
+    // rectangle outside which the bitmap is all one colour is written (**CROPPED**), if that's smaller
+    bool puzz_write(const char * filename, const struct Puzzle * p, const uint8_t * canvas, bool crop);
+    // replace any solution track in filename (already puzz_read() into p) with moves (piece, direction) pairs
+    bool puzz_write_solution(const char * filename, const struct Puzzle * p, const uint8_t * moves, int num_moves);
+
+    #define _PUZZFILE_
+#endif
@@ -0,0 +1,248 @@
+// move rules for PUZZ, ported from src/puzzle.c for host tools
+
+#include "rules.h"
+#include <string.h>
+
+const char * const direction_names[] = { "none", "left", "up", "right", "down", "push" };
+
+void board_from_puzzle(struct Board * b, const struct Puzzle * p) {
+    uint8_t row;
+    b->across = p->squares_across;
+    b->down = p->squares_down;
+    b->slide = p->slide;
+    for (row = 0; row < b->down; row++) {
+        memcpy(&AT(b, row, 0), p->grid[row], b->across);
+    }
+}
+
+void goal_from_puzzle(uint8_t * goal, const struct Puzzle * p) {
+    uint8_t row;
+    for (row = 0; row < p->squares_down; row++) {
+        memcpy(goal + row * p->squares_across, p->goal[row], p->squares_across);
+    }
+}
+
+bool can_move(const struct Board * b, uint8_t piece, int direction) {
+    int row, col;
+    uint8_t old;
+    for (row = 0; row < b->down; row++) {
+        for (col = 0; col < b->across; col++) {
+            if (piece == AT(b, row, col)) {
+                switch (direction) {
+                    case LEFT:
+                        if (col == 0) return false;
+                        old = AT(b, row, col - 1);
+                        break;
+                    case UP:
+                        if (row == 0) return false;
+                        old = AT(b, row - 1, col);
+                        break;
+                    case RIGHT:
+                        if (col == b->across - 1) return false;
+                        old = AT(b, row, col + 1);
+                        break;
+                    case DOWN:
+                        if (row == b->down - 1) return false;
+                        old = AT(b, row + 1, col);
+                        break;
+                    default:
+                        return false;
+                }
+                if (old && (old != piece)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the device walks the grid from the leading edge so each cell is moved before it's overwritten.
+// the result is the piece translated one square, which is all that's needed without the gfx_move() calls
+void move_one_piece(struct Board * b, uint8_t piece, int direction) {
+    int i, n, step;
+    n = b->across * b->down;
+    switch (direction) {
+        case LEFT: step = -1; break;
+        case UP: step = -b->across; break;
+        case RIGHT: step = 1; break;
+        case DOWN: step = b->across; break;
+        default: return;
+    }
+    if (step < 0) {
+        for (i = 0; i < n; i++) {
+            if (b->cell[i] == piece) b->cell[i + step] = piece, b->cell[i] = 0;
+        }
+    } else {
+        for (i = n - 1; i >= 0; i--) {
+            if (b->cell[i] == piece) b->cell[i + step] = piece, b->cell[i] = 0;
+        }
+    }
+}
+
+static bool move_piece(struct Board * b, uint8_t piece, int direction) {
+    if (!can_move(b, piece, direction)) return false;
+    do {
+        move_one_piece(b, piece, direction);
+    } while (b->slide && can_move(b, piece, direction));
+    return true;
+}
+
+// push the line of pieces between piece and an empty cell in the same row (or failing that, column) one square
+// towards the empty cell. Returns true if anything moved
+bool slide_pieces(struct Board * b, uint8_t piece) {
+    int i, j, x, y, zx, zy, direction;
+    int flag = 1;
+
+    x = y = zx = zy = 0;
+    for (i = 0; flag && i < b->down; i++) {
+        for (j = 0; flag && j < b->across; j++) {
+            if (AT(b, i, j) == piece) {
+                x = j;
+                y = i;
+                flag = 0;
+            }
+        }
+    }
+    if (flag) return false; // piece isn't on the board
+
+    for (i = 0; i < b->across; i++) {
+        if (AT(b, y, i) == 0) {
+            flag = 1;
+            zx = i;
+            zy = y;
+        }
+    }
+
+    if (flag == 0) {
+        for (i = 0; i < b->down; i++) {
+            if (AT(b, i, x) == 0) {
+                flag = 1;
+                zx = x;
+                zy = i;
+            }
+        }
+    }
+
+    if (flag == 0) return false;
+
+    if (x == zx) {
+        if (y > zy) {
+            for (i = zy + 1; i < y; i++) {
+                if (AT(b, i, x) == WALL) return false;
+            }
+            direction = UP;
+        } else {
+            for (i = y + 1; i < zy; i++) {
+                if (AT(b, i, x) == WALL) return false;
+            }
+            direction = DOWN;
+        }
+    } else {
+        if (x > zx) {
+            for (i = zx + 1; i < x; i++) {
+                if (AT(b, y, i) == WALL) return false;
+            }
+            direction = LEFT;
+        } else {
+            for (i = x + 1; i < zx; i++) {
+                if (AT(b, y, i) == WALL) return false;
+            }
+            direction = RIGHT;
+        }
+    }
+    // flag is 1 until the first piece moves, which is when the device calls update_score()
+    piece = 0;
+    if (x == zx) {
+        if (y > zy) {
+            for (i = zy + 1; i <= y; i++) {
+                if (AT(b, i, x) && AT(b, i, x) != piece) {
+                    if (!can_move(b, piece = AT(b, i, x), direction)) return !flag;
+                    move_one_piece(b, piece, direction);
+                    flag = 0;
+                }
+            }
+        } else {
+            for (i = zy - 1; i >= y; i--) {
+                if (AT(b, i, x) && AT(b, i, x) != piece) {
+                    if (!can_move(b, piece = AT(b, i, x), direction)) return !flag;
+                    move_one_piece(b, piece, direction);
+                    flag = 0;
+                }
+            }
+        }
+    } else {
+        if (x > zx) {
+            for (i = zx + 1; i <= x; i++) {
+                if (AT(b, y, i) && AT(b, y, i) != piece) {
+                    if (!can_move(b, piece = AT(b, y, i), direction)) return !flag;
+                    move_one_piece(b, piece, direction);
+                    flag = 0;
+                }
+            }
+        } else {
+            for (i = zx - 1; i >= x; i--) {
+                if (AT(b, y, i) && AT(b, y, i) != piece) {
+                    if (!can_move(b, piece = AT(b, y, i), direction)) return !flag;
+                    move_one_piece(b, piece, direction);
+                    flag = 0;
+                }
+            }
+        }
+    }
+    return !flag;
+}
+
+bool click(struct Board * b, uint8_t piece, int direction) {
+    int d;
+    if (direction == PUSH) { // puzzle_click() only pushes when suggest_move() finds no direction at all
+        if (b->slide != 2) return false;
+        for (d = LEFT; d <= DOWN; d++) {
+            if (can_move(b, piece, d)) return false;
+        }
+        return slide_pieces(b, piece);
+    }
+    return move_piece(b, piece, direction);
+}
+
+void start_position(struct MoveLists * m) {
+    int i, j;
+    for (i = 0; i < MAX_PIECES; i++) {
+        for (j = 0; j < 4; j++) {
+            m->list[i][j] = j + 1;
+        }
+    }
+}
+
+void sort_list(struct MoveLists * m, uint8_t piece, int move) {
+    int i;
+    if ((move += 2) > 4) move -= 4; // opposite direction of move
+    for (i = 0; i < 3; i++) {
+        if (move == m->list[piece][i]) {
+            while (i < 3) {
+                m->list[piece][i] = m->list[piece][i + 1];
+                i++;
+            }
+            m->list[piece][3] = move; // last in new list
+            return;
+        }
+    }
+}
+
+int suggest_move(struct MoveLists * m, const struct Board * b, uint8_t piece) {
+    int i, move;
+    for (i = 0; i < 4; i++) {
+        if (can_move(b, piece, move = m->list[piece][i])) {
+            sort_list(m, piece, move);
+            return move;
+        }
+    }
+    return NONE;
+}
+
+bool is_complete(const struct Board * b, const uint8_t * goal) {
+    int i, n;
+    n = b->across * b->down;
+    for (i = 0; i < n; i++) {
+        if (goal[i] && goal[i] != b->cell[i]) return false;
+    }
+    return true;
+}
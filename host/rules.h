@@ -0,0 +1,45 @@
+#ifndef _RULES_
+    // the move rules of src/puzzle.c on a plain grid, with no drawing. Every function here is a port of the
+    // device function of the same name, and must stay in step with it
+    #include "puzzfile.h"
+
+    enum Direction {
+        NONE,
+        LEFT,
+        UP,
+        RIGHT,
+        DOWN,
+        PUSH // slide_pieces() on a piece that can't move itself (slide mode 2 only)
+    };
+
+    struct Board {
+        uint8_t across, down, slide;
+        uint8_t cell[MAX_DOWN * MAX_ACROSS]; // row-major, across cells per row
+    };
+
+    #define AT(b, row, col) ((b)->cell[(row) * (b)->across + (col)])
+
+    // move_list in src/puzzle.c: the directions a click tries for each piece, least recently used first. A
+    // click takes the first one that's legal, so it can go a different way from the one a search chose: the
+    // device gets the others by dragging the piece one move (puzzle_drag()), or from the Demo track
+    struct MoveLists {
+        uint8_t list[MAX_PIECES][4];
+    };
+
+    extern const char * const direction_names[];
+
+    void board_from_puzzle(struct Board * b, const struct Puzzle * p);
+    bool can_move(const struct Board * b, uint8_t piece, int direction);
+    void move_one_piece(struct Board * b, uint8_t piece, int direction);
+    bool slide_pieces(struct Board * b, uint8_t piece);
+    // one left-click's worth of play: move_piece() in direction (sliding on if slide is set), or PUSH.
+    // returns true if update_score() would have been called, i.e. it counts as a move
+    bool click(struct Board * b, uint8_t piece, int direction);
+    void start_position(struct MoveLists * m); // the move_lists as a load or Restart leaves them
+    void sort_list(struct MoveLists * m, uint8_t piece, int move); // move was made: its way back goes last
+    int suggest_move(struct MoveLists * m, const struct Board * b, uint8_t piece); // where a click goes, or NONE
+    bool is_complete(const struct Board * b, const uint8_t * goal); // check_if_complete(), goal laid out as cell
+    void goal_from_puzzle(uint8_t * goal, const struct Puzzle * p);
+
+    #define _RULES_
+#endif
@@ -0,0 +1,336 @@
+// breadth-first PUZZ solver with a packed, canonical position encoding
+
+#include "solve.h"
+#include "codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct Solver {
+    struct Codec codec;
+    int state_bytes;
+
+    uint8_t * states; // state_bytes each, in breadth-first order
+    uint32_t * parent;
+    uint16_t * move_cell;
+    uint8_t * move_direction;
+    size_t count, capacity, max_states;
+    uint32_t * table; // open addressing, holds state index + 1
+    size_t table_mask;
+};
+
+static uint64_t hash_state(const uint8_t * state, int n) {
+    uint64_t h;
+    int i;
+    h = 0xcbf29ce484222325ULL;
+    for (i = 0; i < n; i++) {
+        h = (h ^ state[i]) * 0x100000001b3ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+static bool grow(struct Solver * s) {
+    size_t capacity, i, j;
+    uint32_t * table;
+    capacity = s->capacity ? s->capacity * 2 : 1 << 16;
+    if (capacity > s->max_states) capacity = s->max_states;
+    if (capacity <= s->capacity) return false;
+    if (!(s->states = realloc(s->states, capacity * s->state_bytes))) return false;
+    if (!(s->parent = realloc(s->parent, capacity * sizeof(uint32_t)))) return false;
+    if (!(s->move_cell = realloc(s->move_cell, capacity * sizeof(uint16_t)))) return false;
+    if (!(s->move_direction = realloc(s->move_direction, capacity))) return false;
+    s->capacity = capacity;
+    if (capacity * 2 > s->table_mask + 1) { // keep the table at most half full
+        for (i = 1; i < capacity * 2; i <<= 1) continue;
+        if (!(table = calloc(i, sizeof(uint32_t)))) return false;
+        free(s->table);
+        s->table = table;
+        s->table_mask = i - 1;
+        for (i = 0; i < s->count; i++) {
+            j = hash_state(s->states + i * s->state_bytes, s->state_bytes) & s->table_mask;
+            while (s->table[j]) j = (j + 1) & s->table_mask;
+            s->table[j] = i + 1;
+        }
+    }
+    return true;
+}
+
+// add a position if it's new. Returns its index, or -1 if already seen, or -2 if out of room
+static long insert(struct Solver * s, const uint8_t * state, uint32_t parent, uint16_t cell, uint8_t direction) {
+    size_t j;
+    uint32_t k;
+    if (s->count == s->capacity && !grow(s)) return -2;
+    j = hash_state(state, s->state_bytes) & s->table_mask;
+    while ((k = s->table[j])) {
+        if (!memcmp(s->states + (k - 1) * (size_t)s->state_bytes, state, s->state_bytes)) return -1;
+        j = (j + 1) & s->table_mask;
+    }
+    s->table[j] = s->count + 1;
+    memcpy(s->states + s->count * s->state_bytes, state, s->state_bytes);
+    s->parent[s->count] = parent;
+    s->move_cell[s->count] = cell;
+    s->move_direction[s->count] = direction;
+    return s->count++;
+}
+
+// the index of a position already added, or -1
+static long lookup(const struct Solver * s, const uint8_t * state) {
+    size_t j;
+    uint32_t k;
+    j = hash_state(state, s->state_bytes) & s->table_mask;
+    while ((k = s->table[j])) {
+        if (!memcmp(s->states + (k - 1) * (size_t)s->state_bytes, state, s->state_bytes)) return k - 1;
+        j = (j + 1) & s->table_mask;
+    }
+    return -1;
+}
+
+// replay the winning line on the real board, so the path names the real pieces and is checked as it goes
+static int build_path(const struct Solver * s, const struct Puzzle * p, size_t found, int moves,
+                      struct Solution * solution) {
+    struct Board b;
+    uint8_t goal[MAX_DOWN * MAX_ACROSS];
+    struct SolveMove * m;
+    size_t k;
+    int i;
+    if (!(solution->path = malloc((moves + 1) * sizeof(struct SolveMove)))) return SOLVE_NO_MEMORY;
+    for (k = found, i = moves - 1; i >= 0; k = s->parent[k], i--) {
+        solution->path[i].row = s->move_cell[k] / s->codec.start.across;
+        solution->path[i].col = s->move_cell[k] % s->codec.start.across;
+        solution->path[i].direction = s->move_direction[k];
+    }
+    board_from_puzzle(&b, p);
+    goal_from_puzzle(goal, p);
+    for (i = 0; i < moves; i++) {
+        m = &solution->path[i];
+        m->piece = AT(&b, m->row, m->col);
+        if (!click(&b, m->piece, m->direction)) return SOLVE_REPLAY_FAILED;
+    }
+    return is_complete(&b, goal) ? moves : SOLVE_REPLAY_FAILED;
+}
+
+struct Expand {
+    struct Solver * s;
+    uint32_t parent;
+    long found; // index of the first complete position, or -2 if out of room
+};
+
+static bool expand(void * context, const struct Board * next, const uint8_t * state, uint16_t cell,
+                   uint8_t direction) {
+    struct Expand * e = context;
+    long k;
+    k = insert(e->s, state, e->parent, cell, direction);
+    if (k == -2 || (k >= 0 && is_complete(next, e->s->codec.goal))) {
+        e->found = k;
+        return false;
+    }
+    return true;
+}
+
+static int search(struct Solver * s, const struct Puzzle * p, struct Solution * solution) {
+    struct Board b;
+    uint8_t state[CODEC_MAX_BYTES];
+    struct Expand e;
+    size_t i, level_end;
+    int moves;
+
+    b = s->codec.start;
+    codec_canonicalize(&s->codec, &b);
+    codec_encode(&s->codec, &b, state);
+    insert(s, state, 0, 0, NONE);
+    if (is_complete(&b, s->codec.goal)) return 0;
+    e.s = s;
+    moves = 0;
+    for (i = 0; i < s->count; ) {
+        moves++;
+        for (level_end = s->count; i < level_end; i++) {
+            codec_decode(&s->codec, s->states + i * s->state_bytes, &b);
+            e.parent = i;
+            if (codec_moves(&s->codec, &b, expand, &e)) continue;
+            if (e.found == -2) return s->count >= s->max_states ? SOLVE_LIMIT : SOLVE_NO_MEMORY;
+            return build_path(s, p, e.found, moves, solution);
+        }
+    }
+    return SOLVE_UNSOLVABLE;
+}
+
+int solve_bfs(const struct Puzzle * p, size_t max_states, struct Solution * solution) {
+    struct Solver * s;
+    memset(solution, 0, sizeof(*solution));
+    s = calloc(1, sizeof(*s));
+    if (!s) return solution->moves = SOLVE_NO_MEMORY;
+    s->max_states = max_states < 1 ? 1 : max_states;
+    if (!codec_init(&s->codec, p)) {
+        solution->moves = SOLVE_UNSOLVABLE;
+    } else {
+        s->state_bytes = s->codec.state_bytes;
+        solution->moves = search(s, p, solution);
+    }
+    solution->states = s->count;
+    free(s->states);
+    free(s->parent);
+    free(s->move_cell);
+    free(s->move_direction);
+    free(s->table);
+    free(s);
+    return solution->moves;
+}
+
+void solution_free(struct Solution * solution) {
+    free(solution->path);
+    solution->path = NULL;
+}
+
+int solution_drags(const struct Puzzle * p, struct Solution * solution) {
+    struct Board b;
+    struct MoveLists lists;
+    struct SolveMove * m;
+    uint8_t list[4];
+    int i, drags;
+    board_from_puzzle(&b, p);
+    start_position(&lists);
+    drags = 0;
+    for (i = 0; i < solution->moves; i++) {
+        m = &solution->path[i];
+        m->drag = false;
+        if (m->direction != PUSH) { // a push is only made when a click finds no way at all
+            memcpy(list, lists.list[m->piece], 4);
+            if (suggest_move(&lists, &b, m->piece) != m->direction) {
+                memcpy(lists.list[m->piece], list, 4);
+                sort_list(&lists, m->piece, m->direction); // as puzzle_drag() leaves it
+                m->drag = true;
+                drags++;
+            }
+        }
+        click(&b, m->piece, m->direction);
+    }
+    return drags;
+}
+
+struct Spreading {
+    struct Solver * s;
+    uint32_t * next; // each position's successors, in the order positions are expanded
+    size_t count, capacity;
+    bool full;
+};
+
+static bool add_successor(void * context, const struct Board * next, const uint8_t * state, uint16_t cell,
+                          uint8_t direction) {
+    struct Spreading * sp = context;
+    uint32_t * grown;
+    long k;
+    (void)next;
+    k = insert(sp->s, state, 0, cell, direction);
+    if (k == -1) k = lookup(sp->s, state);
+    if (k == -2) {
+        sp->full = true;
+        return false;
+    }
+    if (sp->count == sp->capacity) {
+        sp->capacity = sp->capacity ? sp->capacity * 2 : 1 << 16;
+        if (!(grown = realloc(sp->next, sp->capacity * sizeof(uint32_t)))) {
+            sp->full = true;
+            return false;
+        }
+        sp->next = grown;
+    }
+    sp->next[sp->count++] = k;
+    return true;
+}
+
+// the positions breadth-first with the moves out of each, then breadth-first backwards from the complete ones
+// through the moves turned round
+static int spread_out(struct Solver * s, struct Spread * spread) {
+    struct Board b;
+    uint8_t state[CODEC_MAX_BYTES];
+    struct Spreading sp;
+    uint32_t * first, * back_first, * back, * queue;
+    size_t i, j, head, tail;
+    int farthest;
+
+    b = s->codec.start;
+    codec_canonicalize(&s->codec, &b);
+    codec_encode(&s->codec, &b, state);
+    insert(s, state, 0, 0, NONE);
+    memset(&sp, 0, sizeof(sp));
+    sp.s = s;
+    first = NULL;
+    for (i = 0; i < s->count; i++) {
+        if (!(i & 0xFFFF) && !(first = realloc(first, (i + 0x10001) * sizeof(uint32_t)))) break;
+        first[i] = sp.count;
+        codec_decode(&s->codec, s->states + i * s->state_bytes, &b);
+        if (!codec_moves(&s->codec, &b, add_successor, &sp) && sp.full) break;
+    }
+    if (i < s->count) {
+        free(first);
+        free(sp.next);
+        return s->count >= s->max_states ? SOLVE_LIMIT : SOLVE_NO_MEMORY;
+    }
+    first[i] = sp.count;
+    spread->moves = malloc(s->count * sizeof(int));
+    back_first = calloc(s->count + 1, sizeof(uint32_t));
+    back = malloc((sp.count + 1) * sizeof(uint32_t));
+    queue = malloc(s->count * sizeof(uint32_t));
+    farthest = SOLVE_NO_MEMORY;
+    if (spread->moves && back_first && back && queue) {
+        for (j = 0; j < sp.count; j++) back_first[sp.next[j] + 1]++;
+        for (i = 0; i < s->count; i++) back_first[i + 1] += back_first[i];
+        for (i = 0; i < s->count; i++) { // back_first[k] counts up to where k's list starts, then is put back
+            for (j = first[i]; j < first[i + 1]; j++) back[back_first[sp.next[j]]++] = i;
+        }
+        for (i = s->count; i > 0; i--) back_first[i] = back_first[i - 1];
+        back_first[0] = 0;
+        for (head = tail = i = 0; i < s->count; i++) {
+            codec_decode(&s->codec, s->states + i * s->state_bytes, &b);
+            spread->moves[i] = is_complete(&b, s->codec.goal) ? 0 : -1;
+            if (!spread->moves[i]) queue[tail++] = i;
+        }
+        farthest = tail ? 0 : SOLVE_UNSOLVABLE;
+        while (head < tail) {
+            i = queue[head++];
+            farthest = spread->moves[i];
+            for (j = back_first[i]; j < back_first[i + 1]; j++) {
+                if (spread->moves[back[j]] < 0) {
+                    spread->moves[back[j]] = farthest + 1;
+                    queue[tail++] = back[j];
+                }
+            }
+        }
+    }
+    free(first);
+    free(sp.next);
+    free(back_first);
+    free(back);
+    free(queue);
+    return farthest;
+}
+
+int solve_spread(const struct Puzzle * p, size_t max_states, struct Spread * spread) {
+    struct Solver * s;
+    int farthest;
+    memset(spread, 0, sizeof(*spread));
+    s = calloc(1, sizeof(*s));
+    if (!s) return SOLVE_NO_MEMORY;
+    s->max_states = max_states < 1 ? 1 : max_states;
+    if (!codec_init(&s->codec, p)) {
+        farthest = SOLVE_UNSOLVABLE;
+    } else {
+        s->state_bytes = s->codec.state_bytes;
+        farthest = spread_out(s, spread);
+    }
+    spread->codec = s->codec;
+    spread->states = s->states; // kept: the rest is only for the search
+    spread->count = s->count;
+    free(s->parent);
+    free(s->move_cell);
+    free(s->move_direction);
+    free(s->table);
+    free(s);
+    return farthest;
+}
+
+void spread_free(struct Spread * spread) {
+    free(spread->states);
+    free(spread->moves);
+    spread->states = NULL;
+    spread->moves = NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef _SOLVE_
+    // shortest-solution search for PUZZ puzzles, counting moves the way update_score() does: one per click
+    #include "codec.h"
+
+    #define SOLVE_UNSOLVABLE -1 // every reachable position was searched
+    #define SOLVE_LIMIT -2 // gave up after max_states positions (positions expanded, for solve_ida)
+    #define SOLVE_NO_MEMORY -3
+    #define SOLVE_REPLAY_FAILED -4 // the path didn't replay on the real pieces: rules.c is out of step
+
+    struct SolveMove {
+        uint8_t row, col; // square to click: the first (row-major) square of the piece
+        uint8_t piece, direction;
+        bool drag; // from solution_drags(): a click would go another way, so the piece is dragged one move
+    };
+
+    struct Solution {
+        int moves; // >= 0, or one of the SOLVE_ codes above
+        size_t states; // distinct positions stored
+        struct SolveMove * path; // moves entries, from the start position
+        int at_least; // 0, or when solve_ida() had to settle for a path that may not be a shortest one, the fewest
+                      // moves a solution can take
+    };
+
+    // breadth-first search of p's grid towards p's goal. Pieces with the same shape that the goal doesn't
+    // mention are interchangeable, so positions that differ only by swapping them are stored once.
+    // each move may go any legal way. A device click goes the first legal way in the piece's move_list, which
+    // isn't always the one wanted (see rules.h), so the fewest moves can take drags as well as clicks. Keeping
+    // the move_lists in the position would make it clicks only, at up to 24 times the positions per piece.
+    // Thread safe: all state lives in the call
+    int solve_bfs(const struct Puzzle * p, size_t max_states, struct Solution * solution);
+    void solution_free(struct Solution * solution);
+    // replays solution with the device's move_lists, setting each move's drag. Returns how many need dragging
+    int solution_drags(const struct Puzzle * p, struct Solution * solution);
+
+    // every position reachable from p's start, found breadth-first as solve_bfs() finds them, and the fewest moves
+    // from each one to p's goal, found a level at a time backwards from the complete ones. For choosing starts by
+    // how hard they are, when all of them fit in max_states
+    struct Spread {
+        struct Codec codec; // for codec_decode() of states, and codec.original[] for the pieces' own numbers
+        uint8_t * states; // count positions, codec.state_bytes each
+        int * moves; // from each position to the goal, or -1 if it can't get there
+        size_t count;
+    };
+
+    // returns the most moves any position needs, or SOLVE_LIMIT if there are more than max_states positions,
+    // SOLVE_UNSOLVABLE if none can reach the goal, or SOLVE_NO_MEMORY. spread_free() it either way
+    int solve_spread(const struct Puzzle * p, size_t max_states, struct Spread * spread);
+    void spread_free(struct Spread * spread);
+
+    // iterative-deepening A* for tile-style puzzles (see pdb.h), for puzzles like the 15 puzzle that have far
+    // too many positions for solve_bfs(). states counts the positions expanded, up to max_nodes. If that runs out
+    // before a shortest path is found, the search starts again trusting the estimate twice over, which finds a
+    // path quickly but maybe not a shortest one, and sets at_least
+    struct Pdb;
+    int solve_ida(const struct Puzzle * p, const struct Pdb * pdb, size_t max_nodes, struct Solution * solution);
+
+    #define _SOLVE_
+#endif
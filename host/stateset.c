@@ -0,0 +1,200 @@
+// sorted, front-coded position files and the streaming merge used by puzz_enum
+
+#include "stateset.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SET_MAGIC "PUZZSET1"
+#define SET_BUFFER (1 << 20)
+
+struct SetHeader {
+    char magic[8];
+    uint32_t bytes, pad;
+    uint64_t count;
+};
+
+static bool write_header(FILE * fp, int bytes, uint64_t count) {
+    struct SetHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SET_MAGIC, sizeof(h.magic));
+    h.bytes = bytes;
+    h.count = count;
+    return fwrite(&h, sizeof(h), 1, fp) == 1;
+}
+
+bool set_create(struct SetWriter * w, const char * path, int bytes) {
+    memset(w, 0, sizeof(*w));
+    w->bytes = bytes;
+    if (!(w->fp = fopen(path, "wb"))) return false;
+    setvbuf(w->fp, NULL, _IOFBF, SET_BUFFER);
+    w->ok = write_header(w->fp, bytes, 0);
+    return true;
+}
+
+bool set_add(struct SetWriter * w, const uint8_t * state) {
+    unsigned shared, v;
+    if (w->count) {
+        for (shared = 0; shared < (unsigned)w->bytes && state[shared] == w->prev[shared]; shared++) continue;
+        if (shared == (unsigned)w->bytes) return w->ok;
+    } else {
+        shared = 0;
+    }
+    for (v = shared; v >= 0x80; v >>= 7) putc((v & 0x7F) | 0x80, w->fp);
+    putc(v, w->fp);
+    fwrite(state + shared, 1, w->bytes - shared, w->fp);
+    memcpy(w->prev + shared, state + shared, w->bytes - shared);
+    w->count++;
+    return w->ok;
+}
+
+bool set_finish(struct SetWriter * w) {
+    bool ok;
+    ok = w->ok && !ferror(w->fp);
+    ok = ok && !fseek(w->fp, 0, SEEK_SET) && write_header(w->fp, w->bytes, w->count);
+    ok = !fclose(w->fp) && ok;
+    w->fp = NULL;
+    return ok;
+}
+
+static bool read_header(FILE * fp, int bytes, uint64_t * count) {
+    struct SetHeader h;
+    if (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, SET_MAGIC, sizeof(h.magic))) return false;
+    if (bytes && h.bytes != (uint32_t)bytes) return false;
+    *count = h.count;
+    return true;
+}
+
+bool set_open(struct SetReader * r, const char * path, int bytes) {
+    memset(r, 0, sizeof(*r));
+    r->bytes = bytes;
+    if (!(r->fp = fopen(path, "rb"))) return false;
+    setvbuf(r->fp, NULL, _IOFBF, SET_BUFFER);
+    if (!read_header(r->fp, bytes, &r->count)) {
+        set_close(r);
+        return false;
+    }
+    r->left = r->count;
+    return true;
+}
+
+bool set_next(struct SetReader * r) {
+    unsigned shared, shift;
+    int c;
+    if (!r->left) return false;
+    shared = shift = 0;
+    do {
+        if ((c = getc(r->fp)) == EOF) return !(r->error = true);
+        shared |= (unsigned)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    if (shared > (unsigned)r->bytes || fread(r->state + shared, 1, r->bytes - shared, r->fp) != r->bytes - shared) {
+        return !(r->error = true);
+    }
+    r->left--;
+    return true;
+}
+
+void set_close(struct SetReader * r) {
+    if (r->fp) fclose(r->fp);
+    r->fp = NULL;
+}
+
+uint64_t set_count(const char * path) {
+    FILE * fp;
+    uint64_t count;
+    if (!(fp = fopen(path, "rb"))) return 0;
+    if (!read_header(fp, 0, &count)) count = 0;
+    fclose(fp);
+    return count;
+}
+
+// binary heap of readers, smallest current position on top
+struct Heap {
+    struct SetReader ** item;
+    int n, bytes;
+};
+
+static bool less(const struct Heap * h, int a, int b) {
+    return memcmp(h->item[a]->state, h->item[b]->state, h->bytes) < 0;
+}
+
+static void sift_down(struct Heap * h, int i) {
+    struct SetReader * t;
+    int child;
+    for (; (child = 2 * i + 1) < h->n; i = child) {
+        if (child + 1 < h->n && less(h, child + 1, child)) child++;
+        if (!less(h, child, i)) break;
+        t = h->item[i];
+        h->item[i] = h->item[child];
+        h->item[child] = t;
+    }
+}
+
+bool set_merge(const char * const * inputs, int n, const char * minus, const char * out, const char * with_minus,
+               int bytes, uint64_t * out_count) {
+    struct SetReader reader[SET_MERGE_WAYS], sub;
+    struct SetReader * item[SET_MERGE_WAYS];
+    struct SetWriter w, u;
+    struct Heap h;
+    uint8_t last[CODEC_MAX_BYTES];
+    bool ok, more_minus, known, have_last;
+    int i, cmp;
+
+    if (n > SET_MERGE_WAYS) return false;
+    h.item = item;
+    h.n = 0;
+    h.bytes = bytes;
+    ok = true;
+    memset(reader, 0, sizeof(reader));
+    for (i = 0; i < n; i++) {
+        ok = set_open(&reader[i], inputs[i], bytes) && ok;
+        if (reader[i].fp && set_next(&reader[i])) h.item[h.n++] = &reader[i];
+    }
+    for (i = h.n / 2 - 1; i >= 0; i--) sift_down(&h, i);
+    memset(&sub, 0, sizeof(sub));
+    if (minus) ok = set_open(&sub, minus, bytes) && ok;
+    more_minus = sub.fp && set_next(&sub);
+    memset(&w, 0, sizeof(w));
+    memset(&u, 0, sizeof(u));
+    ok = ok && set_create(&w, out, bytes);
+    if (with_minus) ok = ok && set_create(&u, with_minus, bytes);
+
+    have_last = false;
+    while (ok && h.n) {
+        if (!have_last || memcmp(h.item[0]->state, last, bytes)) {
+            memcpy(last, h.item[0]->state, bytes);
+            have_last = true;
+            // everything in minus below this position goes straight to with_minus
+            known = false;
+            while (more_minus) {
+                cmp = memcmp(sub.state, last, bytes);
+                if (cmp >= 0) {
+                    known = !cmp;
+                    break;
+                }
+                if (with_minus) set_add(&u, sub.state);
+                more_minus = set_next(&sub);
+            }
+            if (!known) {
+                set_add(&w, last);
+                if (with_minus) set_add(&u, last);
+            }
+        }
+        if (!set_next(h.item[0])) h.item[0] = h.item[--h.n];
+        sift_down(&h, 0);
+    }
+    for (; ok && more_minus; more_minus = set_next(&sub)) {
+        if (with_minus) set_add(&u, sub.state);
+    }
+
+    for (i = 0; i < n; i++) {
+        ok = ok && !reader[i].error;
+        set_close(&reader[i]);
+    }
+    ok = ok && !sub.error;
+    set_close(&sub);
+    if (w.fp) ok = set_finish(&w) && ok;
+    if (u.fp) ok = set_finish(&u) && ok;
+    if (out_count) *out_count = w.count;
+    return ok;
+}
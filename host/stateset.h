@@ -0,0 +1,40 @@
+#ifndef _STATESET_
+    // files of encoded positions (see codec.h), sorted by memcmp() and free of duplicates, so that sets far
+    // bigger than memory can be combined by streaming merges. Each position is front-coded: how many leading
+    // bytes it shares with the one before (a varint), then the bytes that differ
+    #include "codec.h"
+
+    #define SET_MERGE_WAYS 64 // most files set_merge() reads at once
+
+    struct SetWriter {
+        FILE * fp;
+        int bytes;
+        uint64_t count;
+        uint8_t prev[CODEC_MAX_BYTES];
+        bool ok;
+    };
+
+    struct SetReader {
+        FILE * fp;
+        int bytes;
+        uint64_t count, left;
+        bool error; // the file ended early or is damaged
+        uint8_t state[CODEC_MAX_BYTES]; // the current position, after set_next()
+    };
+
+    bool set_create(struct SetWriter * w, const char * path, int bytes);
+    bool set_add(struct SetWriter * w, const uint8_t * state); // in ascending order; repeats of the last are dropped
+    bool set_finish(struct SetWriter * w); // closes the file; false if anything failed to write
+    bool set_open(struct SetReader * r, const char * path, int bytes);
+    bool set_next(struct SetReader * r); // false at the end
+    void set_close(struct SetReader * r);
+    uint64_t set_count(const char * path); // 0 if it can't be read
+
+    // merge up to SET_MERGE_WAYS sets into out, leaving out anything in minus (may be NULL). If with_minus
+    // isn't NULL it gets the union of minus and out, so a breadth-first search can grow its seen set in the
+    // same pass. Returns false on any error
+    bool set_merge(const char * const * inputs, int n, const char * minus, const char * out, const char * with_minus,
+                   int bytes, uint64_t * out_count);
+
+    #define _STATESET_
+#endif
@@ -0,0 +1,209 @@
+// tile atlas for PUZZ on RP6502: see atlas.h
+// squares are stored a pixel row at a time, shifted so the left hand pixel is in the high nibble, and PackBits
+// compressed: a byte n below 128 is followed by n + 1 literal bytes, above 128 by one byte repeated 257 - n times
+
+#include "atlas.h"
+#include "xram.h"
+#include "hint.h"
+#include "instrument.h"
+
+extern uint8_t grid[MAX_DOWN][MAX_ACROSS];
+extern int8_t delta_row[MAX_PIECES], delta_col[MAX_PIECES];
+extern int top_left_x, top_left_y;
+extern uint8_t squares_across, squares_down, square_width, square_height;
+
+static unsigned atlas = XRAM_NONE; // the index, then the pictures
+static uint8_t mark;
+static uint8_t row_buffer[BITMAP_STRIDE];
+
+static unsigned pixel_address(int x, int y) {
+    unsigned u;
+    u = y << 5;
+    return u + (u << 2) + (x >> 1);
+}
+
+// width pixels from (x, y) on screen into row_buffer, left hand pixel in the high nibble of the first byte
+static void get_row(int x, int y, uint8_t bytes) {
+    uint8_t i, b, c;
+    RIA.addr0 = pixel_address(x, y);
+    RIA.step0 = 1;
+    if (x & 0x01) {
+        b = RIA.rw0 << 4;
+        for (i = 0; i < bytes; i++) {
+            c = RIA.rw0;
+            row_buffer[i] = b | (c >> 4);
+            b = c << 4;
+        }
+    } else {
+        for (i = 0; i < bytes; i++) {
+            row_buffer[i] = RIA.rw0;
+        }
+    }
+    if (square_width & 0x01) row_buffer[bytes - 1] &= 0xF0; // keep the neighbour's pixel out of the runs
+}
+
+// row_buffer back to width pixels from (x, y), leaving the pixels either side alone
+static void put_row(int x, int y) {
+    uint8_t i, w;
+    RIA.addr0 = pixel_address(x, y);
+    w = square_width;
+    if (x & 0x01) {
+        RIA.step0 = 0;
+        RIA.rw0 = (RIA.rw0 & 0xF0) | (row_buffer[0] >> 4);
+        RIA.addr0++;
+        RIA.step0 = 1;
+        for (i = 0, w--; w > 1; i++, w -= 2) {
+            RIA.rw0 = (row_buffer[i] << 4) | (row_buffer[i + 1] >> 4);
+        }
+        if (w) {
+            RIA.step0 = 0;
+            RIA.rw0 = (RIA.rw0 & 0x0F) | (row_buffer[i] << 4);
+        }
+    } else {
+        RIA.step0 = 1;
+        for (i = 0; w > 1; i++, w -= 2) {
+            RIA.rw0 = row_buffer[i];
+        }
+        if (w) {
+            RIA.step0 = 0;
+            RIA.rw0 = (RIA.rw0 & 0x0F) | (row_buffer[i] & 0xF0);
+        }
+    }
+}
+
+// row_buffer to RIA.rw1, returns the bytes written
+static unsigned pack_row(uint8_t bytes) {
+    uint8_t i, start, run;
+    unsigned written;
+    written = i = 0;
+    while (i < bytes) {
+        for (run = 1; i + run < bytes && run < 128 && row_buffer[i + run] == row_buffer[i]; run++) continue;
+        if (run > 2) {
+            RIA.rw1 = 257 - run;
+            RIA.rw1 = row_buffer[i];
+            i += run;
+            written += 2;
+        } else {
+            start = i;
+            do {
+                i++;
+            } while (i < bytes && i - start < 128 &&
+                !(i + 2 < bytes && row_buffer[i] == row_buffer[i + 1] && row_buffer[i] == row_buffer[i + 2]));
+            RIA.rw1 = i - start - 1;
+            for (run = start; run < i; run++) {
+                RIA.rw1 = row_buffer[run];
+            }
+            written += i - start + 1;
+        }
+    }
+    return written;
+}
+
+// RIA.rw1 to row_buffer
+static void unpack_row(uint8_t bytes) {
+    uint8_t i, n, b;
+    i = 0;
+    while (i < bytes) {
+        n = RIA.rw1;
+        if (n < 128) {
+            for (n++; n; n--) row_buffer[i++] = RIA.rw1;
+        } else {
+            b = RIA.rw1;
+            for (n = 257 - n; n; n--) row_buffer[i++] = b;
+        }
+    }
+}
+
+void atlas_build(void) {
+    unsigned next, end, entry;
+    uint8_t row, col, y, bytes;
+    int x, top;
+    if (atlas != XRAM_NONE) xram_release(mark);
+    hint_reserve(); // the hint table is budgeted for: the atlas gets what's left
+    mark = xram_mark();
+    atlas = xram_alloc("atlas", xram_free(), 1);
+    if (atlas == XRAM_NONE) return;
+    INSTR_OP();
+    end = XRAM_FREE_END;
+    next = atlas + squares_down * squares_across * ATLAS_INDEX_ENTRY;
+    if (next > end) {
+        xram_release(mark);
+        atlas = XRAM_NONE;
+        return;
+    }
+    bytes = (square_width + 1) >> 1;
+    entry = atlas;
+    RIA.step1 = 1;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            RIA.addr1 = entry;
+            RIA.rw1 = grid[row][col];
+            RIA.rw1 = next & 0xFF;
+            RIA.rw1 = next >> 8;
+            entry += ATLAS_INDEX_ENTRY;
+            if (grid[row][col] == 255) continue;
+            x = top_left_x + col * square_width;
+            top = top_left_y + row * square_height;
+            RIA.addr1 = next;
+            for (y = 0; y < square_height; y++) {
+                if (end - next < bytes + 2) { // worst case for one row: give up, and move pixels instead
+                    xram_release(mark);
+                    atlas = XRAM_NONE;
+                    return;
+                }
+                get_row(x, top + y, bytes);
+                next += pack_row(bytes);
+            }
+        }
+    }
+    xram_release(mark); // and take back just what was used, at the same address
+    atlas = xram_alloc("atlas", next - atlas, 1);
+}
+
+bool atlas_ready(void) {
+    return atlas != XRAM_NONE;
+}
+
+uint8_t atlas_start_piece(uint8_t row, uint8_t col) {
+    RIA.addr1 = atlas + (row * squares_across + col) * ATLAS_INDEX_ENTRY;
+    return RIA.rw1;
+}
+
+void atlas_draw(uint8_t row, uint8_t col, bool start) {
+    uint8_t piece, y, bytes;
+    unsigned addr;
+    int x, top;
+    piece = grid[row][col];
+    if (piece == 255) return;
+    INSTR_OP();
+    x = top_left_x + col * square_width;
+    top = top_left_y + row * square_height;
+    bytes = (square_width + 1) >> 1;
+    if (!piece && !start) {
+        memset(row_buffer, 0, bytes);
+        for (y = 0; y < square_height; y++) put_row(x, top + y);
+        return;
+    }
+    if (piece) { // where this part of the piece was at load time
+        row -= delta_row[piece];
+        col -= delta_col[piece];
+    }
+    RIA.addr1 = atlas + (row * squares_across + col) * ATLAS_INDEX_ENTRY + 1;
+    RIA.step1 = 1;
+    addr = RIA.rw1;
+    addr |= RIA.rw1 << 8;
+    RIA.addr1 = addr;
+    for (y = 0; y < square_height; y++) {
+        unpack_row(bytes);
+        put_row(x, top + y);
+    }
+}
+
+void atlas_draw_board(bool start) {
+    uint8_t row, col;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            atlas_draw(row, col, start);
+        }
+    }
+}
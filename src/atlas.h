@@ -0,0 +1,21 @@
+#ifndef _ATLAS_
+    #include "puzz.h"
+
+    // tile atlas: when a puzzle loads, the picture on every square that isn't a wall is packed into the free
+    // XRAM window, compressed row by row, so any square of the board can be redrawn from grid alone. A piece's
+    // squares are found by how far it has moved since the load (delta_row, delta_col in puzzle.c). The atlas
+    // takes what's left of the window after fixed regions (XRAM_BUDGET): a puzzle whose picture won't fit
+    // doesn't get one, and everything falls back to moving pixels on screen
+    // each grid square has a 3 byte index entry: its piece at load time, then the XRAM address of its picture
+    #define ATLAS_INDEX_ENTRY 3
+
+    void atlas_build(void); // from puzzle_load(), with the start position on screen
+    bool atlas_ready(void); // false if the picture didn't fit
+    uint8_t atlas_start_piece(uint8_t row, uint8_t col); // grid[row][col] as it was loaded
+    // redraw one square as grid and the deltas say it should be. Empty squares are colour 0, as gfx_move() leaves
+    // them, or with start set, the picture they had when they were loaded
+    void atlas_draw(uint8_t row, uint8_t col, bool start);
+    void atlas_draw_board(bool start); // every square that isn't a wall
+
+    #define _ATLAS_
+#endif
@@ -0,0 +1,48 @@
+// the puzzle built into puzz.rp6502 for PUZZ on RP6502: see builtin.h
+
+#include "builtin.h"
+
+#ifdef BUILTIN_PUZZLE
+
+#include "demo.h"
+#include "puzzle.h"
+
+extern char puzzle_filename[];
+
+// generated by tools/builtin.py, each with a 0 after it
+extern const char builtin_header[], builtin_tail[];
+
+static bool fresh = true;
+static const char * next = builtin_header;
+
+bool builtin_fresh(uint8_t number) {
+    return fresh && number == BUILTIN_PUZZLE;
+}
+
+void builtin_used(void) {
+    fresh = false;
+}
+
+void builtin_rewind(void) {
+    next = builtin_header;
+}
+
+bool builtin_gets(char * s, int size) {
+    if (!*next) return false;
+    while (--size && *next) {
+        if ((*s++ = *next++) == '\n') break;
+    }
+    *s = '\0';
+    return true;
+}
+
+void builtin_load(void) {
+    demo_find_in(builtin_tail);
+}
+
+// puzzle_restart() redraws the board from the atlas without reading a file: the rest of the canvas isn't drawn on
+void builtin_put_back(void) {
+    if (builtin_fresh(atoi(puzzle_filename))) puzzle_restart();
+}
+
+#endif
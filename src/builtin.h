@@ -0,0 +1,30 @@
+#ifndef _BUILTIN_
+    #include "puzz.h"
+
+    // a puzzle built into puzz.rp6502 with -DPUZZ_BUILTIN=##.puzz. tools/builtin.py splits the file: the header
+    // lines, up to **CANVAS**, and any solution track are compiled in, and the bitmap and palette become a ROM
+    // asset that the loader puts straight into BITMAP_DATA. While that canvas is there, puzzle_load() takes the
+    // puzzle from RAM and XRAM without reading a file, and its ##.puzz is never written: leaving the puzzle draws
+    // its start position back from the atlas (builtin.py refuses a puzzle whose atlas won't fit), and Save writes
+    // a ##.puzz like any other. XRAM only has room for one canvas, so once another puzzle is loaded the built-in
+    // one is gone until the program is run again, unless the drive has its file
+    #ifdef BUILTIN_PUZZLE
+        bool builtin_fresh(uint8_t number); // the puzzle is number and its canvas is as the ROM loaded it
+        #define builtin_number(number) ((number) == BUILTIN_PUZZLE)
+        void builtin_used(void); // the canvas is about to be loaded over, or drawn on for good
+        void builtin_rewind(void); // read_line_n(NULL, ...) reads the header from its first line
+        bool builtin_gets(char * s, int size); // fgets() from the header
+        void builtin_load(void); // in place of reading the canvas: finds the track in RAM
+        void builtin_put_back(void); // after mouse_loop(): the start position, so the canvas is as it was loaded
+    #else
+        #define builtin_fresh(number) false
+        #define builtin_number(number) false
+        #define builtin_used() ((void)0)
+        #define builtin_rewind() ((void)0)
+        #define builtin_gets(s, size) false
+        #define builtin_load() ((void)0)
+        #define builtin_put_back() ((void)0)
+    #endif
+
+    #define _BUILTIN_
+#endif
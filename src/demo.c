@@ -0,0 +1,85 @@
+// solution track playback for PUZZ on RP6502: see demo.h
+
+#include "demo.h"
+#include "puzzle.h"
+
+extern char puzzle_filename[];
+extern char line_buffer[];
+
+static long track_offset; // file offset of the first move
+static unsigned track_moves, moves_left; // track_moves is 0 if the puzzle has no track
+static uint8_t buffer[DEMO_BUFFER], buffered, next, last_vsync;
+static int track_fd = -1; // open while playing
+static const char * track_ram; // a track in RAM, played from there and not from puzzle_filename
+static const char * playing_ram; // its next move, while playing
+
+void demo_find(int fd) {
+    char c;
+    track_moves = 0;
+    track_ram = NULL;
+    if (read(fd, line_buffer, DEMO_MARK_SIZE) != DEMO_MARK_SIZE || strncmp(line_buffer, DEMO_MARK, DEMO_MARK_SIZE)) {
+        return;
+    }
+    while (read(fd, &c, 1) == 1 && c != '\n') {
+        if (c >= '0' && c <= '9') track_moves = track_moves * 10 + c - '0';
+    }
+    track_offset = lseek(fd, 0, SEEK_CUR);
+}
+
+void demo_find_in(const char * track) {
+    track_moves = 0;
+    track_ram = NULL;
+    if (strncmp(track, DEMO_MARK, DEMO_MARK_SIZE)) return;
+    for (track += DEMO_MARK_SIZE; *track && *track != '\n'; track++) {
+        if (*track >= '0' && *track <= '9') track_moves = track_moves * 10 + *track - '0';
+    }
+    if (*track) track_ram = track + 1;
+    else track_moves = 0;
+}
+
+void demo_start(void) {
+    demo_stop();
+    puzzle_restart(); // the track starts from the start position
+    if (!track_moves) return;
+    if (track_ram) {
+        playing_ram = track_ram;
+    } else {
+        track_fd = open(puzzle_filename, O_RDONLY);
+        if (track_fd < 0) return;
+        if (lseek(track_fd, track_offset, SEEK_SET) != track_offset) {
+            demo_stop();
+            return;
+        }
+    }
+    moves_left = track_moves;
+    buffered = next = 0;
+    last_vsync = RIA.vsync;
+}
+
+void demo_step(void) {
+    uint8_t piece, direction;
+    unsigned n;
+    if ((track_fd < 0 && !playing_ram) || (uint8_t)(RIA.vsync - last_vsync) < DEMO_VSYNCS) return;
+    last_vsync = RIA.vsync;
+    if (next == buffered) {
+        n = moves_left < DEMO_BUFFER / 2 ? moves_left * 2 : DEMO_BUFFER;
+        if (playing_ram) {
+            memcpy(buffer, playing_ram, n);
+            playing_ram += n;
+        } else if (read(track_fd, buffer, n) != n) {
+            demo_stop();
+            return;
+        }
+        buffered = n;
+        next = 0;
+    }
+    piece = buffer[next++];
+    direction = buffer[next++];
+    if (!puzzle_move(piece, direction) || !--moves_left) demo_stop(); // stop at the end, or if the track is wrong
+}
+
+void demo_stop(void) {
+    if (track_fd >= 0) close(track_fd);
+    track_fd = -1;
+    playing_ram = NULL;
+}
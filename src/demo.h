@@ -0,0 +1,19 @@
+#ifndef _DEMO_
+    #include "puzz.h"
+
+    // Puzzle menu Demo: restart the puzzle and play its solution track, one move every DEMO_VSYNCS frames.
+    // The track follows the palette in the ##.puzz file (puzz_solve -w writes it): a "**SOLUTION**" line, a line
+    // with the number of moves, then two bytes per move, piece and direction. It's read DEMO_BUFFER bytes at a time
+    #define DEMO_MARK "**SOLUTION**\n"
+    #define DEMO_MARK_SIZE 13
+    #define DEMO_VSYNCS 8
+    #define DEMO_BUFFER 32
+
+    void demo_find(int fd); // from puzzle_load(), with fd just past the palette
+    void demo_find_in(const char * track); // the same from a track in RAM: the built-in puzzle's (builtin.h)
+    void demo_start(void); // menu action
+    void demo_step(void); // called every mouse poll: makes the next move when it's due
+    void demo_stop(void); // a click or the menu ends playback
+
+    #define _DEMO_
+#endif
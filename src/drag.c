@@ -0,0 +1,167 @@
+// carrying a dragged piece on the pointer's layer for PUZZ on RP6502: see drag.h
+// the sprite's left edge is on an even pixel, so the piece's pixels keep the same nibble in the sprite as on screen
+
+#include "drag.h"
+#include "puzzle.h"
+#include "xram.h"
+#include "hint.h"
+#include "demo.h"
+#include "instrument.h"
+
+extern uint8_t grid[MAX_DOWN][MAX_ACROSS];
+extern int top_left_x, top_left_y;
+extern uint8_t squares_across, squares_down, square_width, square_height;
+
+enum DragOp {
+    DRAG_CUT, // screen to sprite, leaving colour 0 behind as gfx_move() does
+    DRAG_FILL, // the see-through colour into the sprite
+    DRAG_PUT_BACK // sprite to screen
+};
+
+static unsigned sprite = XRAM_NONE; // config struct, palette, then pixels
+static unsigned pixels;
+static uint8_t mark, stride, fill, num_squares;
+static int sprite_left, sprite_top, grab_x, grab_y;
+static uint8_t square_row[PATH_MAX_SQUARES], square_col[PATH_MAX_SQUARES];
+static bool used[16]; // colours the piece's pixels use
+
+static unsigned pixel_address(int x, int y) {
+    unsigned u;
+    u = y << 5;
+    return u + (u << 2) + (x >> 1);
+}
+
+// a rectangle of pixels between the screen and the same place in the sprite, or filled in the sprite. Edge bytes
+// are masked so the pixels either side are left alone
+static void transfer(int x, int y, uint8_t width, uint8_t height, uint8_t op) {
+    unsigned screen, buffer;
+    uint8_t bytes, first_mask, last_mask, mask, i, b;
+    screen = pixel_address(x, y);
+    buffer = pixels + (unsigned)(y - sprite_top) * stride + ((x - sprite_left) >> 1);
+    bytes = ((x + width - 1) >> 1) - (x >> 1) + 1;
+    first_mask = x & 0x01 ? 0x0F : 0xFF;
+    last_mask = (x + width) & 0x01 ? 0xF0 : 0xFF;
+    RIA.step0 = RIA.step1 = 0;
+    while (height--) {
+        RIA.addr0 = screen;
+        RIA.addr1 = buffer;
+        for (i = 0; i < bytes; i++) {
+            mask = i ? 0xFF : first_mask;
+            if (i == bytes - 1) mask &= last_mask;
+            if (op == DRAG_CUT) {
+                b = RIA.rw0 & mask;
+                if (mask & 0xF0) used[b >> 4] = true;
+                if (mask & 0x0F) used[b & 0x0F] = true;
+                RIA.rw1 = (RIA.rw1 & ~mask) | b;
+                RIA.rw0 &= ~mask;
+            } else if (op == DRAG_FILL) {
+                RIA.rw1 = (RIA.rw1 & ~mask) | (fill & mask);
+            } else {
+                RIA.rw0 = (RIA.rw0 & ~mask) | (RIA.rw1 & mask);
+            }
+            RIA.addr0++, RIA.addr1++;
+        }
+        screen += BITMAP_STRIDE;
+        buffer += stride;
+    }
+}
+
+// the button was pressed at (from_x, from_y) and the pointer is now at (x, y). Nothing happens until it's on
+// another square; then the piece pressed on is lifted, unless it's too big to drag or there's no room for it
+bool drag_lift(int from_x, int from_y, int x, int y) {
+    uint8_t row, col, to_row, to_col, piece, top, left, bottom, right, height, i;
+    int box_x, width;
+    if (sprite != XRAM_NONE || !board_square(from_x, from_y, &row, &col)) return false;
+    if (board_square(x, y, &to_row, &to_col) && to_row == row && to_col == col) return true;
+    piece = grid[row][col];
+    if (!piece || piece == 255) return false;
+    top = left = 255;
+    bottom = right = num_squares = 0;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            if (grid[row][col] != piece) continue;
+            if (num_squares == PATH_MAX_SQUARES) return false; // puzzle_drag() wouldn't move it
+            if (top == 255) top = row;
+            if (col < left) left = col;
+            if (col > right) right = col;
+            bottom = row;
+            square_row[num_squares] = row;
+            square_col[num_squares++] = col;
+        }
+    }
+    box_x = top_left_x + left * square_width;
+    sprite_left = box_x & ~1;
+    sprite_top = top_left_y + top * square_height;
+    width = box_x - sprite_left + (right - left + 1) * square_width;
+    height = (bottom - top + 1) * square_height;
+    stride = (width + 1) >> 1;
+    mark = xram_mark();
+    sprite = xram_alloc("drag sprite", DRAG_STRUCT_SIZE + PALETTE_SIZE + (unsigned)stride * height, 2);
+    if (sprite == XRAM_NONE) return false;
+    pixels = sprite + DRAG_STRUCT_SIZE + PALETTE_SIZE;
+    hint_stop(); // before its highlight is cut out with the piece
+    demo_stop();
+    INSTR_OP();
+    memset(used, 0, sizeof(used));
+    for (i = 0; i < num_squares; i++) {
+        transfer(top_left_x + square_col[i] * square_width, top_left_y + square_row[i] * square_height,
+            square_width, square_height, DRAG_CUT);
+    }
+    for (fill = 0; fill < 15 && used[fill]; fill++) continue; // using all 16, its colour 15 shows through
+    fill |= fill << 4;
+    for (row = top; row <= bottom; row++) {
+        for (col = left; col <= right; col++) {
+            if (grid[row][col] != piece) {
+                transfer(top_left_x + col * square_width, top_left_y + row * square_height,
+                    square_width, square_height, DRAG_FILL);
+            }
+        }
+    }
+    if (box_x & 0x01) transfer(sprite_left, sprite_top, 1, height, DRAG_FILL);
+    if (width & 0x01) transfer(sprite_left + width, sprite_top, 1, height, DRAG_FILL);
+    RIA.addr0 = PALETTE_DATA;
+    RIA.step0 = 1;
+    RIA.addr1 = sprite + DRAG_STRUCT_SIZE;
+    RIA.step1 = 1;
+    for (i = 0; i < PALETTE_SIZE; i++) {
+        RIA.rw1 = i == (fill & 0x0F) * 2 ? RIA.rw0 & ~PALETTE_ALPHA : RIA.rw0;
+    }
+    grab_x = from_x;
+    grab_y = from_y;
+    xram0_struct_set(sprite, vga_mode3_config_t, x_wrap, false);
+    xram0_struct_set(sprite, vga_mode3_config_t, y_wrap, false);
+    xram0_struct_set(sprite, vga_mode3_config_t, width_px, stride * 2);
+    xram0_struct_set(sprite, vga_mode3_config_t, height_px, height);
+    xram0_struct_set(sprite, vga_mode3_config_t, xram_data_ptr, pixels);
+    xram0_struct_set(sprite, vga_mode3_config_t, xram_palette_ptr, sprite + DRAG_STRUCT_SIZE);
+    drag_follow(x, y);
+    xreg_vga_mode(3, 2, sprite, 2); // 4-bit, on the pointer's layer
+    return true;
+}
+
+bool drag_carrying(void) {
+    return sprite != XRAM_NONE;
+}
+
+void drag_follow(int x, int y) {
+    if (sprite == XRAM_NONE) return;
+    x += sprite_left - grab_x;
+    y += sprite_top - grab_y;
+    xram0_struct_set(sprite, vga_mode3_config_t, x_pos_px, x);
+    xram0_struct_set(sprite, vga_mode3_config_t, y_pos_px, y);
+}
+
+void drag_drop(bool put_back) {
+    uint8_t i;
+    if (sprite == XRAM_NONE) return;
+    if (put_back) {
+        INSTR_OP();
+        for (i = 0; i < num_squares; i++) {
+            transfer(top_left_x + square_col[i] * square_width, top_left_y + square_row[i] * square_height,
+                square_width, square_height, DRAG_PUT_BACK);
+        }
+    }
+    xreg_vga_mode(3, 3, MOUSE_PTR_STRUCT, 2); // the pointer back on (topmost) layer 2
+    xram_release(mark);
+    sprite = XRAM_NONE;
+}
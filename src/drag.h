@@ -0,0 +1,19 @@
+#ifndef _DRAG_
+    #include "puzz.h"
+
+    // carrying a dragged piece: once the pointer leaves the square the left button was pressed on, the piece is cut
+    // out of the bitmap, once, into a sprite in the free XRAM window, and shown as a 4-bit vga_mode3 layer in place
+    // of the pointer on layer 2. Following the pointer then only sets the layer's x_pos_px and y_pos_px. When it's
+    // dropped, puzzle_drag() has the picture put back and moves it with gfx_move() (or redraws it from the atlas)
+    // if the drop was legal. The sprite isn't in XRAM_BUDGET: a piece that won't fit in what's left of the window
+    // isn't carried, and drags as it did before. Squares of the bounding box that aren't the piece's are a palette
+    // colour the piece doesn't use, copied from the puzzle's palette with its alpha bit cleared
+    #define DRAG_STRUCT_SIZE 0x10 // vga_mode3_config_t, then the palette, then the pixels
+
+    bool drag_lift(int from_x, int from_y, int x, int y); // left button held: false if what's there can't be carried
+    bool drag_carrying(void);
+    void drag_follow(int x, int y); // pointer moved to (x, y)
+    void drag_drop(bool put_back); // pointer back on layer 2, and the piece back where it was cut from if put_back
+
+    #define _DRAG_
+#endif
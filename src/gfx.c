@@ -2,31 +2,67 @@
 // ceptimus April 2024
 
 #include "gfx.h"
+#include "builtin.h"
+#include "instrument.h"
+
+extern char puzzle_filename[];
 
 uint8_t bytes_per_row;
 
+// text-layer writes are queued here and sent to XRAM in one sequential run of RIA.rw0 writes, so consecutive
+// text_at()/n_chars_at() calls that continue where the last one stopped (box edges, Moves: counter) cost one
+// RIA.addr0 setup between them. Anything that isn't contiguous flushes the queue first, so ordering is kept
+#define TEXT_QUEUE_SIZE 80 // one 40-column row of character/attribute pairs
+static uint8_t text_queue[TEXT_QUEUE_SIZE];
+static uint8_t text_queued;
+static unsigned text_queue_addr;
+
+void text_flush(void) {
+    uint8_t i;
+    if (text_queued) {
+        INSTR_OP();
+        RIA.addr0 = text_queue_addr;
+        RIA.step0 = 1;
+        for (i = 0; i < text_queued; i++)
+            RIA.rw0 = text_queue[i];
+        text_queued = 0;
+    }
+}
+
+// start queueing at addr, flushing first unless addr carries straight on from what's already queued
+static void text_queue_at(unsigned addr) {
+    if (addr != text_queue_addr + text_queued || text_queued == TEXT_QUEUE_SIZE) {
+        text_flush();
+        text_queue_addr = addr;
+    }
+}
+
 void erase_bitmap(void) {
     unsigned i;
     RIA.addr0 = BITMAP_DATA;
     RIA.step0 = 1;
-    for (i = 0; i < PALETTE_DATA; i++)
+    for (i = 0; i < BITMAP_SIZE; i++)
         RIA.rw0 = 0;
-    for (i = 0; i < 32; i++)
+    for (i = 0; i < PALETTE_SIZE; i++)
         RIA.rw0 = 0; // initial palette all black
 }
 
 void text_at(uint8_t row, uint8_t col, uint8_t fg, uint8_t bg, char * text) {
     fg = (fg & 0x0F) | (bg << 4);
-    RIA.addr0 = CHARACTER_DATA  + row * bytes_per_row + col * 2;
-    RIA.step0 = 1;
+    text_queue_at(CHARACTER_DATA + row * bytes_per_row + col * 2);
     while (*text) {
-        RIA.rw0 = *text++;
-        RIA.rw0 = fg;
+        if (text_queued == TEXT_QUEUE_SIZE) {
+            text_queue_at(text_queue_addr + TEXT_QUEUE_SIZE); // full: flush, and carry on from where it stopped
+        }
+        text_queue[text_queued++] = *text++;
+        text_queue[text_queued++] = fg;
     }
 }
 
 void text_colour(uint8_t row, uint8_t col, uint8_t fg, uint8_t bg, int length) {
     fg = (fg & 0x0F) | (bg << 4);
+    text_flush(); // attribute-only writes step over the characters, so can't share the queue
+    INSTR_OP();
     RIA.addr0 = CHARACTER_DATA + row * bytes_per_row + col * 2 + 1;
     RIA.step0 = 2;
     while (length--) {
@@ -35,13 +71,27 @@ void text_colour(uint8_t row, uint8_t col, uint8_t fg, uint8_t bg, int length) {
 }
 
 void n_chars_at(uint8_t row, uint8_t col, uint8_t fg, uint8_t bg, int n, char c) {
+    unsigned addr;
     fg = (fg & 0x0F) | (bg << 4);
-    
-    RIA.addr0 = CHARACTER_DATA + row * 80 + col * 2;
-    RIA.step0 = 1;
+    addr = CHARACTER_DATA + row * bytes_per_row + col * 2;
+    if (n > TEXT_QUEUE_SIZE / 2) { // too big to queue (clearing the screen): flush, then stream it straight out
+        text_flush();
+        INSTR_OP();
+        RIA.addr0 = addr;
+        RIA.step0 = 1;
+        while (n--) {
+            RIA.rw0 = c;
+            RIA.rw0 = fg;
+        }
+        return;
+    }
+    text_queue_at(addr);
     while (n--) {
-        RIA.rw0 = c;
-        RIA.rw0 = fg;
+        if (text_queued == TEXT_QUEUE_SIZE) {
+            text_queue_at(text_queue_addr + TEXT_QUEUE_SIZE);
+        }
+        text_queue[text_queued++] = c;
+        text_queue[text_queued++] = fg;
     }
 }
 
@@ -51,11 +101,12 @@ void erase_characters(void) { // clear text screen
 
 // move a rectangle of pixels, no overlap of source and destination, pixels are 4 bits wide
 // source rectangle is filled with colour fill
-// with default PUZZ XRAM allocation, any coordinate after top:240, left:63 will target unallocated off-screen XRAM
+// coordinates past the bottom of the canvas target the free XRAM window: use XRAM_TOP() and XRAM_LEFT() of an xram_alloc() region
 void gfx_move(int src_left, int src_top, int dest_left, int dest_top, uint8_t width, uint8_t height, uint8_t fill) {
     unsigned u;
     uint8_t shift, b, w, h, next_row_step0, next_row_step1, preload_left, trailing_right;
     uint8_t fill_high, fill_both;    
+    INSTR_OP();
     shift = ((uint8_t)src_left ^ (uint8_t)dest_left) & 0x01;
     fill_high = fill << 4;
     fill_both = fill | fill_high;
@@ -172,6 +223,32 @@ void gfx_move(int src_left, int src_top, int dest_left, int dest_top, uint8_t wi
     }
 }
 
+// invert the colours of a rectangle of pixels. addr0 writes back what addr1 has just read, a byte behind
+void gfx_invert(int left, int top, int width, uint8_t height) {
+    unsigned u;
+    int w;
+    uint8_t bytes;
+    INSTR_OP();
+    u = top << 5;
+    u = u + (u << 2) + (left >> 1); // address containing top left pixel
+    RIA.step0 = RIA.step1 = 1;
+    while (height--) {
+        RIA.addr0 = RIA.addr1 = u;
+        w = width;
+        if (left & 0x01) { // left hand edge is the low nibble
+            RIA.rw0 = RIA.rw1 ^ 0x0F;
+            w--;
+        }
+        for (bytes = w >> 1; bytes; bytes--) {
+            RIA.rw0 = RIA.rw1 ^ 0xFF;
+        }
+        if (w & 0x01) { // right hand edge is the high nibble
+            RIA.rw0 = RIA.rw1 ^ 0xF0;
+        }
+        u += BITMAP_STRIDE;
+    }
+}
+
 void gfx_init(void) {
     xreg_vga_canvas(1);
 
@@ -194,7 +271,10 @@ void gfx_init(void) {
     xram0_struct_set(CHARACTER_STRUCT, vga_mode1_config_t, xram_palette_ptr, 0xFFFF);
     xram0_struct_set(CHARACTER_STRUCT, vga_mode1_config_t, xram_font_ptr, 0xFFFF);
 
-    erase_bitmap();
+    if (!builtin_fresh(atoi(puzzle_filename))) { // a built-in canvas waits there for puzzle_load()
+        builtin_used(); // or is gone for good
+        erase_bitmap();
+    }
     xreg_vga_mode(3, 2, BITMAP_STRUCT, 0);
     erase_characters();
     xreg(1, 0, 1, 1, 2, CHARACTER_STRUCT, 1); // character mode (Mode 1) on layer 1
@@ -205,6 +285,7 @@ void gfx_init(void) {
 void scroll_screen(void) {
     int offset;
     uint8_t delta, vsync;
+    text_flush(); // show the final Moves count before celebrating
     offset = 0;
     for (delta = 1; delta < 6; delta++) {
         offset -= delta;
@@ -0,0 +1,414 @@
+// on-device hints for PUZZ on RP6502: see hint.h
+// the search works on a copy of the grid and of each piece's move_list, so a searched click goes the way the
+// real click would. Each piece's bounding box is kept as it moves, so testing a move only looks at the squares
+// the piece covers, and the distance to the goal is updated a piece at a time rather than recounted
+
+#include "hint.h"
+#include "puzzle.h"
+#include "gfx.h"
+#include "xram.h"
+
+extern uint8_t grid[MAX_DOWN][MAX_ACROSS];
+extern uint8_t goal[MAX_DOWN][MAX_ACROSS];
+extern uint8_t move_list[MAX_PIECES][4];
+extern int top_left_x, top_left_y;
+extern uint8_t squares_across, squares_down, square_width, square_height, slide;
+
+#define NO_PIECE 0xFF // no goal position for a piece index, or no hint found
+
+enum HintState {
+    HINT_IDLE,
+    HINT_SEARCHING,
+    HINT_SHOWN
+};
+
+struct HintFrame { // one click on the path being searched
+    uint8_t piece, direction, squares; // piece index clicked, the way it went, and how far (0 once undone)
+    uint8_t list[4]; // the piece's move_list before the click
+};
+
+static const uint8_t opposite[5] = { NONE, RIGHT, DOWN, LEFT, UP };
+
+static uint8_t search[MAX_DOWN][MAX_ACROSS];
+static uint8_t order[HINT_MAX_PIECES][4]; // move_list of each piece index
+static uint8_t id[HINT_MAX_PIECES], top[HINT_MAX_PIECES], left[HINT_MAX_PIECES];
+static uint8_t height[HINT_MAX_PIECES], width[HINT_MAX_PIECES];
+// where the goal lets a piece's top left square be: any of the squares from (goal_top, goal_left) to
+// (goal_bottom, goal_right). A goal often names only some of a piece's squares, so a piece can finish in more
+// than one place. goal_top is NO_PIECE if the goal doesn't place the piece
+static uint8_t goal_top[HINT_MAX_PIECES], goal_left[HINT_MAX_PIECES];
+static uint8_t goal_bottom[HINT_MAX_PIECES], goal_right[HINT_MAX_PIECES];
+static struct HintFrame path[HINT_MAX_DEPTH];
+static unsigned distance, hash, check; // lower bound on clicks to the goal, and two hashes of the position
+static unsigned bound, next_bound, best_distance, nodes;
+static uint8_t num_pieces, depth, best_piece, iteration, shown;
+static uint8_t state = HINT_IDLE;
+static unsigned table = XRAM_NONE;
+
+// lower bound on the clicks piece index i needs to reach the nearest of its goal places: a click moves one
+// piece, a square at a time when slide is 0, otherwise as far as it goes, but only along one axis
+static uint8_t piece_distance(uint8_t i) {
+    uint8_t down, across;
+    if (goal_top[i] == NO_PIECE) return 0;
+    down = top[i] < goal_top[i] ? goal_top[i] - top[i] : top[i] > goal_bottom[i] ? top[i] - goal_bottom[i] : 0;
+    across = left[i] < goal_left[i] ? goal_left[i] - left[i] : left[i] > goal_right[i] ? left[i] - goal_right[i] : 0;
+    if (slide) return (down != 0) + (across != 0);
+    return down + across;
+}
+
+static void hash_piece(uint8_t i) { // toggle piece index i at its position in or out of both hashes
+    unsigned position;
+    position = (top[i] << 5) | left[i];
+    hash ^= position * 0x9E37 + i * 0x3C6F;
+    check ^= position * 0x4F1B + i * 0x2D55 + 0x6A09;
+}
+
+static bool fits(uint8_t i, uint8_t direction) { // can_move() for piece index i in search
+    uint8_t row, col, bottom, right, piece, other;
+    int8_t dr, dc;
+    dr = dc = 0;
+    switch (direction) {
+        case LEFT:
+            if (!left[i]) return false;
+            dc = -1;
+            break;
+        case UP:
+            if (!top[i]) return false;
+            dr = -1;
+            break;
+        case RIGHT:
+            if (left[i] + width[i] == squares_across) return false;
+            dc = 1;
+            break;
+        case DOWN:
+            if (top[i] + height[i] == squares_down) return false;
+            dr = 1;
+            break;
+        default:
+            return false;
+    }
+    piece = id[i];
+    bottom = top[i] + height[i];
+    right = left[i] + width[i];
+    for (row = top[i]; row < bottom; row++) {
+        for (col = left[i]; col < right; col++) {
+            if (search[row][col] == piece) {
+                other = search[row + dr][col + dc];
+                if (other && other != piece) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// move piece index i one square in search, which it must fit, keeping distance and the hashes up to date
+static void shift(uint8_t i, uint8_t direction) {
+    uint8_t row, col, bottom, right, piece;
+    int8_t dr, dc;
+    dr = direction == UP ? -1 : direction == DOWN;
+    dc = direction == LEFT ? -1 : direction == RIGHT;
+    piece = id[i];
+    bottom = top[i] + height[i];
+    right = left[i] + width[i];
+    if (dr < 0 || dc < 0) { // leading edge first, so no square is overwritten before it has moved
+        for (row = top[i]; row < bottom; row++) {
+            for (col = left[i]; col < right; col++) {
+                if (search[row][col] == piece) {
+                    search[row][col] = 0;
+                    search[row + dr][col + dc] = piece;
+                }
+            }
+        }
+    } else {
+        for (row = bottom; row-- > top[i]; ) {
+            for (col = right; col-- > left[i]; ) {
+                if (search[row][col] == piece) {
+                    search[row][col] = 0;
+                    search[row + dr][col + dc] = piece;
+                }
+            }
+        }
+    }
+    distance -= piece_distance(i);
+    hash_piece(i);
+    top[i] += dr;
+    left[i] += dc;
+    distance += piece_distance(i);
+    hash_piece(i);
+}
+
+// what puzzle_click() does to frame->piece, except PUSH: suggest_move(), sort_list(), then slide as far as the
+// slide setting says. Returns the squares moved, 0 if the piece can't move
+static uint8_t click(struct HintFrame * frame) {
+    uint8_t i, j, back, squares;
+    i = frame->piece;
+    for (j = 0; j < 4 && !fits(i, order[i][j]); j++) continue;
+    if (j == 4) return 0;
+    memcpy(frame->list, order[i], 4);
+    frame->direction = order[i][j];
+    back = opposite[frame->direction];
+    for (j = 0; j < 3 && order[i][j] != back; j++) continue; // the way back goes to the end of the list
+    for (; j < 3; j++) {
+        order[i][j] = order[i][j + 1];
+    }
+    order[i][3] = back;
+    squares = 0;
+    do {
+        shift(i, frame->direction);
+        squares++;
+    } while (slide && fits(i, frame->direction));
+    return squares;
+}
+
+static void unclick(struct HintFrame * frame) {
+    uint8_t back;
+    back = opposite[frame->direction];
+    for (; frame->squares; frame->squares--) {
+        shift(frame->piece, back);
+    }
+    memcpy(order[frame->piece], frame->list, 4);
+}
+
+static bool complete(void) { // check_if_complete() for search
+    uint8_t row, col;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            if (goal[row][col] && goal[row][col] != search[row][col]) return false;
+        }
+    }
+    return true;
+}
+
+// true if piece index i, with its top left square at (r, c), covers every square the goal names it in: those
+// are all between (goal_top, goal_left) and (goal_bottom, goal_right) while places() is working them out
+static bool covers(uint8_t i, uint8_t r, uint8_t c) {
+    uint8_t row, col;
+    for (row = goal_top[i]; row <= goal_bottom[i]; row++) {
+        for (col = goal_left[i]; col <= goal_right[i]; col++) {
+            if (goal[row][col] == id[i] && search[top[i] + row - r][left[i] + col - c] != id[i]) return false;
+        }
+    }
+    return true;
+}
+
+// from the squares the goal names piece index i in, to the places its top left square can finish
+static void places(uint8_t i) {
+    int r, c, first_r, last_r, first_c, last_c;
+    uint8_t found_top, found_left, found_bottom, found_right;
+    if (goal_top[i] == NO_PIECE) return;
+    first_r = goal_bottom[i] - height[i] + 1; // the piece's box has to take in the named squares' box
+    if (first_r < 0) first_r = 0;
+    last_r = goal_top[i];
+    if (last_r > squares_down - height[i]) last_r = squares_down - height[i];
+    first_c = goal_right[i] - width[i] + 1;
+    if (first_c < 0) first_c = 0;
+    last_c = goal_left[i];
+    if (last_c > squares_across - width[i]) last_c = squares_across - width[i];
+    found_top = found_left = NO_PIECE;
+    found_bottom = found_right = 0;
+    for (r = first_r; r <= last_r; r++) {
+        for (c = first_c; c <= last_c; c++) {
+            if (!covers(i, r, c)) continue;
+            if (r < found_top) found_top = r;
+            if (r > found_bottom) found_bottom = r;
+            if (c < found_left) found_left = c;
+            if (c > found_right) found_right = c;
+        }
+    }
+    goal_top[i] = found_top; // NO_PIECE if the piece's shape can't cover them: the goal is ignored for it
+    goal_left[i] = found_left;
+    goal_bottom[i] = found_bottom;
+    goal_right[i] = found_right;
+}
+
+static void clear_table(void) {
+    unsigned n;
+    RIA.addr1 = table;
+    RIA.step1 = 1;
+    for (n = HINT_TABLE_SIZE; n; n--) {
+        RIA.rw1 = 0;
+    }
+}
+
+// true if this iteration has already been here in no more clicks, otherwise records it. The table ignores the
+// move_lists, and check is only 16 bits, so now and then a hint is longer than it need be
+static bool seen(uint8_t clicks) {
+    unsigned addr;
+    uint8_t low, high, it, c;
+    addr = table + ((hash & (HINT_TABLE_ENTRIES - 1)) << 2);
+    RIA.addr1 = addr;
+    RIA.step1 = 1;
+    low = RIA.rw1;
+    high = RIA.rw1;
+    it = RIA.rw1;
+    c = RIA.rw1;
+    if (it == iteration && low == (uint8_t)check && high == (uint8_t)(check >> 8) && c <= clicks) return true;
+    RIA.addr1 = addr;
+    RIA.rw1 = (uint8_t)check;
+    RIA.rw1 = check >> 8;
+    RIA.rw1 = iteration;
+    RIA.rw1 = clicks;
+    return false;
+}
+
+static void start_iteration(unsigned new_bound) {
+    if (table != XRAM_NONE && !++iteration) { // entries are tagged with the iteration: clear them when it wraps
+        clear_table();
+        iteration = 1;
+    }
+    bound = new_bound;
+    next_bound = 0xFFFF;
+    depth = 0;
+    path[0].piece = NO_PIECE; // the first ++ makes it index 0
+    path[0].squares = 0;
+}
+
+// invert the colours of piece's squares, a run of squares along each row at a time so no byte is done twice
+static void highlight(uint8_t piece) {
+    uint8_t row, col, first;
+    for (row = 0; row < squares_down; row++) {
+        col = 0;
+        while (col < squares_across) {
+            if (grid[row][col] != piece) {
+                col++;
+                continue;
+            }
+            for (first = col; col < squares_across && grid[row][col] == piece; col++) continue;
+            gfx_invert(top_left_x + first * square_width, top_left_y + row * square_height,
+                (col - first) * square_width, square_height);
+        }
+    }
+}
+
+static void show(uint8_t i) {
+    if (i == NO_PIECE) {
+        state = HINT_IDLE;
+        return;
+    }
+    shown = id[i];
+    highlight(shown);
+    state = HINT_SHOWN;
+}
+
+void hint_reserve(void) {
+    if (table == XRAM_NONE) { // taken once and kept: it's in XRAM_BUDGET
+        table = xram_alloc("hint table", HINT_TABLE_SIZE, 4);
+        if (table != XRAM_NONE) {
+            clear_table();
+            iteration = 0;
+        }
+    }
+}
+
+void hint_start(void) {
+    uint8_t row, col, piece, i;
+    hint_stop();
+    memcpy(search, grid, sizeof(search));
+    num_pieces = 0;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            piece = search[row][col];
+            if (!piece || piece == 255) continue;
+            for (i = 0; i < num_pieces && id[i] != piece; i++) continue;
+            if (i == num_pieces) {
+                if (num_pieces == HINT_MAX_PIECES) return; // too many pieces: no hint
+                num_pieces++;
+                id[i] = piece;
+                top[i] = row;
+                left[i] = col;
+                height[i] = width[i] = 1;
+                goal_top[i] = NO_PIECE;
+                memcpy(order[i], move_list[piece], 4);
+            } else {
+                if (col < left[i]) {
+                    width[i] += left[i] - col;
+                    left[i] = col;
+                } else if (col >= left[i] + width[i]) {
+                    width[i] = col - left[i] + 1;
+                }
+                height[i] = row - top[i] + 1;
+            }
+        }
+    }
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            piece = goal[row][col];
+            for (i = 0; i < num_pieces && id[i] != piece; i++) continue;
+            if (i == num_pieces) continue;
+            if (goal_top[i] == NO_PIECE) {
+                goal_top[i] = goal_bottom[i] = row;
+                goal_left[i] = goal_right[i] = col;
+            } else {
+                goal_bottom[i] = row;
+                if (col < goal_left[i]) goal_left[i] = col;
+                if (col > goal_right[i]) goal_right[i] = col;
+            }
+        }
+    }
+    distance = hash = check = 0;
+    for (i = 0; i < num_pieces; i++) {
+        places(i);
+        distance += piece_distance(i);
+        hash_piece(i);
+    }
+    if (complete()) return;
+    hint_reserve();
+    nodes = 0;
+    best_distance = 0xFFFF;
+    best_piece = NO_PIECE;
+    state = HINT_SEARCHING;
+    start_iteration(distance);
+}
+
+// iterative deepening depth-first search with the path kept in path[], so it can stop at a vsync and carry on
+// from the same place at the next poll
+void hint_step(void) {
+    struct HintFrame * frame;
+    unsigned f;
+    uint8_t vsync;
+    if (state != HINT_SEARCHING) return;
+    vsync = RIA.vsync;
+    while (vsync == RIA.vsync) {
+        frame = &path[depth];
+        if (frame->squares) unclick(frame);
+        if (++frame->piece == num_pieces) { // every click from here tried
+            if (depth) {
+                depth--;
+                continue;
+            }
+            if (next_bound > HINT_MAX_DEPTH) { // nothing within reach: settle for the closest position found
+                show(best_piece);
+                return;
+            }
+            start_iteration(next_bound);
+            continue;
+        }
+        if (!(frame->squares = click(frame))) continue;
+        if (distance < best_distance) {
+            best_distance = distance;
+            best_piece = path[0].piece;
+        }
+        if (complete()) { // distance can be 0 short of the goal, where a piece has more than one place to go
+            show(path[0].piece);
+            return;
+        }
+        if (++nodes > HINT_MAX_NODES) {
+            show(best_piece);
+            return;
+        }
+        f = depth + 1 + distance;
+        if (f > bound) {
+            if (f < next_bound) next_bound = f;
+            continue;
+        }
+        if (depth + 1 == HINT_MAX_DEPTH || (table != XRAM_NONE && seen(depth + 1))) continue;
+        depth++;
+        path[depth].piece = NO_PIECE;
+        path[depth].squares = 0;
+    }
+}
+
+void hint_stop(void) {
+    if (state == HINT_SHOWN) highlight(shown); // inverting again puts the colours back
+    state = HINT_IDLE;
+}
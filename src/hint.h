@@ -0,0 +1,18 @@
+#ifndef _HINT_
+    #include "puzz.h"
+
+    // Puzzle menu Hint: an IDA* search over a copy of the grid for the next click towards the goal, run a frame's
+    // worth at a time from the mouse loop so the pointer and menus keep working. The piece to click is shown
+    // with its colours inverted until the next click or menu
+    #define HINT_MAX_PIECES 64 // puzzles with more pieces than this don't get hints
+    #define HINT_MAX_DEPTH 24 // clicks searched ahead
+    #define HINT_MAX_NODES 12000u // give up and show the closest position's first click after this many
+    // the transposition table (check, iteration, clicks from start) is HINT_TABLE_SIZE, in XRAM_BUDGET in puzz.h
+
+    void hint_reserve(void); // take the table, if it hasn't been, before anything that uses the rest of the window
+    void hint_start(void); // menu action
+    void hint_step(void); // called every mouse poll: searches until the next vsync
+    void hint_stop(void); // abandon the search and remove the highlight, before anything touches grid or bitmap
+
+    #define _HINT_
+#endif
@@ -0,0 +1,80 @@
+// latency and frame-time instrumentation for PUZZ on RP6502
+// measurements nest: only the outermost INSTR_BEGIN()/INSTR_END() pair is recorded, so a menu action that
+// reloads the puzzle is timed as a load, and the menu redraw around it as a menu event
+
+#include "instrument.h"
+
+#ifdef INSTRUMENT
+
+#include "gfx.h"
+
+extern char puzzle_filename[];
+
+struct InstrStats {
+    unsigned count, last_frames, worst_frames, last_ops, worst_ops;
+    unsigned long total_frames;
+};
+
+static const char * const event_names[INSTR_EVENTS] = { "click", "load", "save", "menu" };
+static struct InstrStats stats[INSTR_EVENTS];
+static uint8_t depth, event, last_vsync;
+static unsigned frames, ops_start;
+static char overlay[32];
+
+unsigned instr_ops;
+
+// accumulate frames since the last poll. Polled on every RIA operation as well as at the ends of a measurement,
+// so a span longer than the 8-bit RIA.vsync counter can hold is still counted correctly
+void instr_poll(void) {
+    uint8_t vsync;
+    vsync = RIA.vsync;
+    frames += (uint8_t)(vsync - last_vsync);
+    last_vsync = vsync;
+}
+
+void instr_begin(uint8_t new_event) {
+    if (!depth++) {
+        event = new_event;
+        last_vsync = RIA.vsync;
+        frames = 0;
+        ops_start = instr_ops;
+    }
+}
+
+void instr_end(void) {
+    struct InstrStats * s;
+    unsigned ops;
+    if (--depth) return;
+    text_flush(); // queued text is part of the work being timed
+    instr_poll();
+    ops = instr_ops - ops_start;
+    if (!ops) return; // nothing was drawn, e.g. a click on an empty cell or a wall
+    s = &stats[event];
+    s->count++;
+    s->last_frames = frames;
+    s->last_ops = ops;
+    s->total_frames += frames;
+    if (frames > s->worst_frames) s->worst_frames = frames;
+    if (ops > s->worst_ops) s->worst_ops = ops;
+    sprintf(overlay, "%-5s%4u/%-4u%6u/%-6u", event_names[event], frames, s->worst_frames, ops, s->worst_ops);
+    text_at(INSTR_ROW, INSTR_COL, 7, 0, overlay);
+    text_flush();
+}
+
+void instr_log(void) {
+    FILE * fp;
+    uint8_t i;
+    struct InstrStats * s;
+    fp = fopen(INSTR_LOG_FILE, "a");
+    if (fp == NULL) return;
+    fprintf(fp, "%.7s event count frames(last worst total) ops(last worst)\n", puzzle_filename);
+    for (i = 0; i < INSTR_EVENTS; i++) {
+        s = &stats[i];
+        fprintf(fp, "%-5s %5u %5u %5u %7lu %5u %5u\n", event_names[i], s->count,
+            s->last_frames, s->worst_frames, s->total_frames, s->last_ops, s->worst_ops);
+    }
+    fclose(fp);
+    memset(stats, 0, sizeof(stats));
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _INSTRUMENT_
+    #include "puzz.h"
+
+    // optional on-device timing, built with -DPUZZ_INSTRUMENT=ON. Counts vsyncs (frames) and RIA operations
+    // (gfx_move() blits, text-layer flushes, XRAM file transfers) between INSTR_BEGIN() and INSTR_END(), shows the
+    // last and worst values on the bottom row of the 40-column text layer and logs a summary when a puzzle is quit
+    enum InstrEvent {
+        INSTR_CLICK,
+        INSTR_LOAD,
+        INSTR_SAVE,
+        INSTR_MENU,
+        INSTR_EVENTS
+    };
+
+    #ifdef INSTRUMENT
+        #define INSTR_ROW 29 // no puzzle puts its Moves: counter on the bottom row
+        #define INSTR_COL 13 // "click   3/12     140/900   " fits in the 27 columns to the right edge
+        #define INSTR_LOG_FILE "puzz_instr.log"
+
+        extern unsigned instr_ops;
+
+        void instr_begin(uint8_t event);
+        void instr_end(void);
+        void instr_poll(void);
+        void instr_log(void);
+
+        #define INSTR_BEGIN(event) instr_begin(event)
+        #define INSTR_END() instr_end()
+        #define INSTR_OP() (instr_ops++, instr_poll())
+        #define INSTR_LOG() instr_log()
+    #else
+        #define INSTR_BEGIN(event) ((void)0)
+        #define INSTR_END() ((void)0)
+        #define INSTR_OP() ((void)0)
+        #define INSTR_LOG() ((void)0)
+    #endif
+
+    #define _INSTRUMENT_
+#endif
@@ -5,6 +5,7 @@
 #include "gfx.h"
 #include "mouse.h"
 #include "puzzle.h"
+#include "builtin.h"
 
 extern const char puzz_identifier[];
 extern char puzzle_filename[];
@@ -16,6 +17,7 @@ static uint8_t file_number[46];
 static uint8_t num_files;
 static int selected = -2; // file number highlighted, or -1 for Quit, or -2 for none
 uint8_t first_unused_puzz_number; // this number will be used for any saves ##.puzz 
+static uint8_t menu_header[MENU_CACHE_HEADER];
 
 void select(int row, int col) {
     int new_selection;
@@ -44,6 +46,47 @@ void select(int row, int col) {
     }
 }
 
+// the finished menu screen from MENU_CACHE, straight into CHARACTER_DATA. False if there isn't one, or it's out of
+// date: the number a save would use has been taken since (puzzle_save() removes the file when it takes one). Files
+// copied to or deleted from the drive by hand aren't noticed; a chosen file that has gone removes the cache
+static bool menu_cache_load(void) {
+    int fd;
+    bool ok;
+    FILE * fp;
+    fd = open(MENU_CACHE, O_RDONLY);
+    if (fd < 0) return false;
+    ok = read(fd, menu_header, MENU_CACHE_HEADER) == MENU_CACHE_HEADER &&
+        !memcmp(menu_header, MENU_CACHE_ID, MENU_CACHE_ID_SIZE);
+    if (ok && menu_header[MENU_CACHE_ID_SIZE] < 44) { // the unused number is checked before the screen is touched
+        sprintf(puzzle_filename, "%02u.puzz", menu_header[MENU_CACHE_ID_SIZE + 1]);
+        fp = fopen(puzzle_filename, "r");
+        if (fp) fclose(fp);
+        ok = fp == NULL;
+    }
+    ok = ok && read_xram(CHARACTER_DATA, CHARACTER_SIZE, fd) == CHARACTER_SIZE;
+    close(fd);
+    if (!ok) return false;
+    num_files = menu_header[MENU_CACHE_ID_SIZE];
+    first_unused_puzz_number = menu_header[MENU_CACHE_ID_SIZE + 1];
+    memcpy(file_number, menu_header + MENU_CACHE_ID_SIZE + 2, 44);
+    return true;
+}
+
+// keep the menu screen just built, before anything's highlighted, for next time
+static void menu_cache_save(void) {
+    int fd;
+    text_flush();
+    fd = open(MENU_CACHE, O_CREAT | O_WRONLY | O_TRUNC);
+    if (fd < 0) return; // read-only drive: build the menu every time
+    memcpy(menu_header, MENU_CACHE_ID, MENU_CACHE_ID_SIZE);
+    menu_header[MENU_CACHE_ID_SIZE] = num_files;
+    menu_header[MENU_CACHE_ID_SIZE + 1] = first_unused_puzz_number;
+    memcpy(menu_header + MENU_CACHE_ID_SIZE + 2, file_number, 44);
+    write(fd, menu_header, MENU_CACHE_HEADER);
+    write_xram(CHARACTER_DATA, CHARACTER_SIZE, fd);
+    close(fd);
+}
+
 // scanner/handler for main menu (choosing puzzle to load) on 640 x 480 canvas. returns ## of selected puzzle (0 to 43)
 static uint8_t mouse(void) { 
     static int sx, sy, prev_x, prev_y;
@@ -53,6 +96,7 @@ static uint8_t mouse(void) {
 
     chosen = 0xFF;
     while (chosen == 0xFF) {
+        text_flush();
         RIA.addr0 = MOUSE_INPUT_STRUCT + 1;
         rw = RIA.rw0;
         if (mx != rw) {
@@ -110,6 +154,7 @@ void main() {
     FILE * fp;
     
     uint8_t i, row, col;
+    bool cache;
     while (true) {
         // use a character screen, 80x30 chars, 16-colour, as the 'choose puzzle' main menu
         xram0_struct_set(CHARACTER_STRUCT, vga_mode1_config_t, x_wrap, false);
@@ -126,59 +171,77 @@ void main() {
         xreg_vga_canvas(3);
         xreg(1, 0, 1, 1, 10, CHARACTER_STRUCT, 0); // character mode (Mode 1) on layer 0
         bytes_per_row = 160;
-        text_at(0, 10, 11, 0, "PUZZ sliding block puzzle games for the picocomputer RP6502");
-        text_at(2, 0, 11, 0, "You need a mouse to play these puzzles. Click a puzzle below, to load it.");
-        text_at(3, 0, 11, 0, "Once a puzzle is displayed, left-click on a piece to move it, or right-click to");
-        text_at(4, 0, 11, 0, "access the menus for: instructions, restarting, saving, quitting, etcetera.");
-        text_at(29, 2, 15, 0, "Quit");
-        text_at(29, 18, 15, 0, "Or press Esc to quit");
-        text_at(29, 65, 8, 0, "\xB8 2024 ceptimus");
+        if (!menu_cache_load()) {
+            erase_characters(); // a cache cut short may have been part read
+            text_at(0, 10, 11, 0, "PUZZ sliding block puzzle games for the picocomputer RP6502");
+            text_at(2, 0, 11, 0, "You need a mouse to play these puzzles. Click a puzzle below, to load it.");
+            text_at(3, 0, 11, 0, "Once a puzzle is displayed, left-click on a piece to move it, or right-click to");
+            text_at(4, 0, 11, 0, "access the menus for: instructions, restarting, saving, quitting, etcetera.");
+            text_at(29, 2, 15, 0, "Quit");
+            text_at(29, 18, 15, 0, "Or press Esc to quit");
+            text_at(29, 65, 8, 0, "\xB8 2024 ceptimus");
 
-        // wouldn't have to search like this if there were a way to read a directory.  Maybe in a future release?
-        first_unused_puzz_number = 43; // will hold number used for saving a puzzle
-        num_files = 0; // number of ##.puzz files found (only room on screen for 44)
-        for (i = 0; i < 44; i++) {
-            sprintf(puzzle_filename, "%02u.puzz", i);
-            row = num_files > 21 ? num_files - 16 : num_files + 6;
-            col = num_files > 21 ? 41 : 0;
-            fp = fopen(puzzle_filename, "r");
-            if (fp == NULL) {
-                puzzle_filename[2] = '\0';
-                text_at(row, col, 15, 0, puzzle_filename);
-                if (i < first_unused_puzz_number) first_unused_puzz_number = i;
-                continue;
-            } else {
-                if (fgets(line_buffer, MAX_LINE, fp) && !strncmp(line_buffer, puzz_identifier, 13)) { // if a valid ##.puzz file
-                    read_line_n(fp, 1, puzzle_filename);
-                    line_buffer[13] = '\0';
-                    text_at(row, col + 3, 15, 0, line_buffer);
-                    read_line_n(fp, 1, puzzle_filename);
-                    line_buffer[21] = '\0';
-                    text_at(row, col + 18, 15, 0, line_buffer);
+            // wouldn't have to search like this if there were a way to read a directory.  Maybe in a future release?
+            first_unused_puzz_number = 43; // will hold number used for saving a puzzle
+            num_files = 0; // number of ##.puzz files found (only room on screen for 44)
+            cache = true;
+            for (i = 0; i < 44; i++) {
+                sprintf(puzzle_filename, "%02u.puzz", i);
+                row = num_files > 21 ? num_files - 16 : num_files + 6;
+                col = num_files > 21 ? 41 : 0;
+                fp = fopen(puzzle_filename, "r");
+                if (fp == NULL && builtin_number(i)) cache = false; // listed or not, depending on the canvas
+                if (fp == NULL && !builtin_fresh(i)) {
                     puzzle_filename[2] = '\0';
                     text_at(row, col, 15, 0, puzzle_filename);
-                    file_number[num_files] = i;
-                    num_files++;
+                    if (i < first_unused_puzz_number) first_unused_puzz_number = i;
+                    continue;
+                } else {
+                    if (fp == NULL) builtin_rewind(); // the built-in puzzle, when the drive hasn't got its file
+                    if ((fp ? fgets(line_buffer, MAX_LINE, fp) != NULL : builtin_gets(line_buffer, MAX_LINE)) &&
+                        !strncmp(line_buffer, puzz_identifier, 13)) { // if a valid ##.puzz file
+                        read_line_n(fp, 1, puzzle_filename);
+                        line_buffer[13] = '\0';
+                        text_at(row, col + 3, 15, 0, line_buffer);
+                        read_line_n(fp, 1, puzzle_filename);
+                        line_buffer[21] = '\0';
+                        text_at(row, col + 18, 15, 0, line_buffer);
+                        puzzle_filename[2] = '\0';
+                        text_at(row, col, 15, 0, puzzle_filename);
+                        file_number[num_files] = i;
+                        num_files++;
+                    }
+                    if (fp) fclose(fp);
                 }
-                fclose(fp);
             }
-        }
-        if (!num_files) {
-            puts("No ##.puzz files found (where ## = 00 to 43).");
-            puts("Have you cd-ed to the correct directory?");
-            exit(1);
-        } else if (num_files < 44) {
-            row = num_files > 21 ? num_files - 16 : num_files + 6;
-            col = num_files > 21 ? 41 : 0;
-            text_at(row, col, 0, 0, "  ");
+            if (!num_files) {
+                puts("No ##.puzz files found (where ## = 00 to 43).");
+                puts("Have you cd-ed to the correct directory?");
+                exit(1);
+            } else if (num_files < 44) {
+                row = num_files > 21 ? num_files - 16 : num_files + 6;
+                col = num_files > 21 ? 41 : 0;
+                text_at(row, col, 0, 0, "  ");
+            }
+            if (cache) menu_cache_save();
         }
         mouse_init();
         xreg(0, 0, 0x00, KEYBOARD_STRUCT); // enable keyboard access to detect pressing of Esc key
-        sprintf(puzzle_filename, "%02u.puzz\n", mouse());
+        i = mouse();
+        sprintf(puzzle_filename, "%02u.puzz\n", i);
+        if (!builtin_fresh(i)) {
+            fp = fopen(puzzle_filename, "r");
+            if (fp == NULL) { // gone since MENU_CACHE was made: make the menu again, from the files there are now
+                remove(MENU_CACHE);
+                continue;
+            }
+            fclose(fp);
+        }
         sprintf(save_prompt, "Save (%02u.puzz)", first_unused_puzz_number);
         gfx_init();
         mouse_init();
         puzzle_load();
         mouse_loop();
+        builtin_put_back();
     }
 }
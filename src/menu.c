@@ -3,18 +3,32 @@
 
 #include "menu.h"
 #include "puzzle.h"
+#include "hint.h"
+#include "demo.h"
+#include "instrument.h"
 
 extern bool puzzle_quit;
 
 static void quit(void);
+static void quick_save0(void), quick_save1(void), quick_save2(void);
+static void quick_load0(void), quick_load1(void), quick_load2(void);
 
 char instructions[6][27];
 char save_prompt[15];
+char quick_prompt[QUICK_SLOTS][QUICK_PROMPT];
+
+static struct MenuItem item_quick_load2 = { quick_load2, NULL, 5, quick_prompt[2] };
+static struct MenuItem item_quick_load1 = { quick_load1, &item_quick_load2, 4, quick_prompt[1] };
+static struct MenuItem item_quick_load0 = { quick_load0, &item_quick_load1, 3, quick_prompt[0] };
+static struct MenuItem item_quick_save2 = { quick_save2, &item_quick_load0, 2, "Save 3" };
+static struct MenuItem item_quick_save1 = { quick_save1, &item_quick_save2, 1, "Save 2" };
+static struct MenuItem item_quick_save0 = { quick_save0, &item_quick_save1, 0, "Save 1" };
+static struct Menu menu_slots = { 28, 13, 6, -2, "Slots", &item_quick_save0, NULL };
 
 static struct MenuItem item_about2 = { NULL, NULL, 2, "Amiga April 2024" };
 static struct MenuItem item_about1 = { NULL, &item_about2, 1, " Converted from" };
 static struct MenuItem item_about0 = { NULL, &item_about1, 0, "RP6502 Puzz V1.0" };
-static struct Menu menu_about = {21, 16, 3, 0, "About", &item_about0, NULL };
+static struct Menu menu_about = {21, 16, 3, 0, "About", &item_about0, &menu_slots };
 
 static struct MenuItem item_instructions5 = { NULL, NULL, 5, instructions[5] };
 static struct MenuItem item_instructions4 = { NULL, &item_instructions5, 4, instructions[4] };
@@ -24,10 +38,13 @@ static struct MenuItem item_instructions1 = { NULL, &item_instructions2, 1, inst
 static struct MenuItem item_instructions0 = { NULL, &item_instructions1, 0, instructions[0] };
 static struct Menu menu_instructions = { 8, 26, 6, 0, "Instructions", &item_instructions0, &menu_about };
 
-static struct MenuItem item_quit = { quit, NULL, 2, "Quit" };
-static struct MenuItem item_save = { puzzle_save, &item_quit, 1, save_prompt};
-static struct MenuItem item_restart = { puzzle_load, &item_save, 0, "Restart" };
-static struct Menu menu_puzzle = { 1, 14, 3, 0, "Puzzle", &item_restart, &menu_instructions };
+static struct MenuItem item_quit = { quit, NULL, 5, "Quit" };
+static struct MenuItem item_save = { puzzle_save, &item_quit, 4, save_prompt};
+static struct MenuItem item_demo = { demo_start, &item_save, 3, "Demo" };
+static struct MenuItem item_hint = { hint_start, &item_demo, 2, "Hint" };
+static struct MenuItem item_shuffle = { puzzle_shuffle, &item_hint, 1, "Shuffle" };
+static struct MenuItem item_restart = { puzzle_restart, &item_shuffle, 0, "Restart" };
+static struct Menu menu_puzzle = { 1, 14, 6, 0, "Puzzle", &item_restart, &menu_instructions };
 
 static struct MenuBar menu_bar =  { 15, 8, 14, 4, &menu_puzzle };
 
@@ -40,6 +57,13 @@ static void quit(void) {
     puzzle_quit = true;
 }
 
+static void quick_save0(void) { puzzle_quick_save(0); }
+static void quick_save1(void) { puzzle_quick_save(1); }
+static void quick_save2(void) { puzzle_quick_save(2); }
+static void quick_load0(void) { puzzle_quick_load(0); }
+static void quick_load1(void) { puzzle_quick_load(1); }
+static void quick_load2(void) { puzzle_quick_load(2); }
+
 static void erase_active_menu(void) {
     uint8_t row;
     for (row = 1; row <= menu_bottom; row++) {
@@ -82,6 +106,7 @@ void right_mouse_move(int x, int y) {
     struct Menu *menu;
     struct MenuItem *item;
     uint8_t i;
+    INSTR_BEGIN(INSTR_MENU);
     if (x < 0) x = 0;
     if (y < 0) y = 0;
     x >>= 3, y >>= 3; // convert from pixel to character coordinates
@@ -120,26 +145,34 @@ void right_mouse_move(int x, int y) {
     } else {
         cancel_active_item();
     }
+    INSTR_END();
 }
 
 void right_mouse_down(int x, int y) {
     struct Menu *menu;
+    INSTR_BEGIN(INSTR_MENU);
+    hint_stop(); // Save writes the bitmap out, so no highlight, and a search would go stale
+    demo_stop();
     n_chars_at(0, 0, menu_bar.fg_colour, menu_bar.bg_colour, 40, ' '); // grey background top row of text
 
     for (menu = menu_bar.first; menu; menu = menu->next) {
         text_at(0, menu->left, menu_bar.fg_colour, menu_bar.bg_colour, menu->title);
     }
     right_mouse_move(x, y);
+    INSTR_END();
 }
 
 void right_mouse_up(int x, int y) {
+    INSTR_BEGIN(INSTR_MENU);
     right_mouse_move(x, y);
     n_chars_at(0, 0, 0, 0, 40, 0);
     if (active_menu) {
         erase_active_menu();
         active_menu = NULL;
     }
+    INSTR_END(); // time the menu closing, not the action it runs
     if (active_item && active_item->action) {
+        text_flush(); // close the menu on screen before a slow action such as Save
         active_item->action();
     }
     active_item = NULL;
@@ -4,9 +4,18 @@
 #include "mouse.h"
 #include "puzzle.h"
 #include "menu.h"
+#include "hint.h"
+#include "demo.h"
+#include "drag.h"
+#include "session.h"
+#include "instrument.h"
 
 extern bool puzzle_quit;
 
+static bool hovering; // pointer showing MOUSE_PTR_PALETTE: there's a piece under it that can move
+static int sx, sy; // pointer position, scaled by MOUSE_DIV
+static uint8_t mb, mx, my; // the mouse's buttons and counters at the last poll
+
 static void draw_mouse_ptr(void) {
     const uint8_t data[121] = { // Amiga Workbench v2.x mouse pointer, grey top edge instead of white
          9, 8,00,00,00,00,00,00,00,00,00,
@@ -29,27 +38,57 @@ static void draw_mouse_ptr(void) {
         RIA.rw0 = data[i];
 }
 
+// the pointer's colours 8, 9 and 16 with the red body turned green. 0 (and what the pointer doesn't use) see-through
+static void draw_mouse_palette(void) {
+    const unsigned palette[17] = { // blue, green (5 bits each), alpha bit, red (5 bits) from the top
+        0, 0, 0, 0, 0, 0, 0, 0, 0x8430, 0x07E0, 0, 0, 0, 0, 0, 0, 0x0020
+    };
+    uint8_t i;
+    RIA.addr0 = MOUSE_PTR_PALETTE;
+    RIA.step0 = 1;
+    for (i = 0; i < 17; i++) {
+        RIA.rw0 = palette[i] & 0xFF;
+        RIA.rw0 = palette[i] >> 8;
+    }
+}
+
+// over a piece that can move, the pointer turns green: its palette pointer changes, no pixels are drawn
+static void hover(bool movable) {
+    unsigned palette;
+    if (movable != hovering) {
+        hovering = movable;
+        palette = movable ? MOUSE_PTR_PALETTE : 0xFFFF;
+        xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, xram_palette_ptr, palette);
+    }
+}
+
 static bool mouse(void) { // returns true when quit selected
-    static int sx, sy, prev_x, prev_y;
-    static uint8_t mb, mx, my;
+    static int prev_x, prev_y, press_x, press_y;
+    static bool lift; // until the piece pressed on turns out not to be one that can be carried
     int x, y;
-    uint8_t rw, changed, pressed, released;
+    uint8_t rw, rx, ry, changed, pressed, released;
 
-    RIA.addr0 = MOUSE_INPUT_STRUCT + 1;
+    hint_step(); // any search in progress runs until the next vsync
+    demo_step();
+    text_flush(); // show anything queued for the text layer since the last poll
+    RIA.addr0 = MOUSE_INPUT_STRUCT + 0;
     rw = RIA.rw0;
-    if (mx != rw) {
-        sx += (int8_t)(rw - mx);
-        mx = rw;
+    RIA.addr0 = MOUSE_INPUT_STRUCT + 1;
+    rx = RIA.rw0;
+    RIA.addr0 = MOUSE_INPUT_STRUCT + 2;
+    ry = RIA.rw0;
+    SESSION_INPUT(&rw, &rx, &ry); // recorded, or replaced by a recording
+    if (mx != rx) {
+        sx += (int8_t)(rx - mx);
+        mx = rx;
         if (sx < -MOUSE_DIV)
             sx = -MOUSE_DIV;
         if (sx > (CANVAS_WIDTH - 2) * MOUSE_DIV)
             sx = (CANVAS_WIDTH - 2) * MOUSE_DIV;
     }
-    RIA.addr0 = MOUSE_INPUT_STRUCT + 2;
-    rw = RIA.rw0;
-    if (my != rw) {
-        sy += (int8_t)(rw - my);
-        my = rw;
+    if (my != ry) {
+        sy += (int8_t)(ry - my);
+        my = ry;
         if (sy < -MOUSE_DIV)
             sy = -MOUSE_DIV;
         if (sy > (CANVAS_HEIGHT - 2) * MOUSE_DIV)
@@ -59,16 +98,26 @@ static bool mouse(void) { // returns true when quit selected
     y = sy / MOUSE_DIV;
     xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, x_pos_px, x);
     xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, y_pos_px, y);
-    RIA.addr0 = MOUSE_INPUT_STRUCT + 0;
-    rw = RIA.rw0;
     changed = mb ^ rw;
     pressed = rw & changed;
     released = mb & changed;
     mb = rw;
-    if (pressed & 1) {
-        puzzle_click(x, y);
+    if (pressed & 1) { // clicks happen on release, so a press can turn into a drag
+        press_x = x;
+        press_y = y;
+        lift = true;
+    } else if (released & 1) {
+        puzzle_drag(press_x, press_y, x, y);
+        drag_drop(true); // a carried piece that didn't move goes back where it was
+    } else if (mb & 1) {
+        if (drag_carrying()) {
+            drag_follow(x, y);
+        } else if (lift) {
+            lift = drag_lift(press_x, press_y, x, y);
+        }
     }
     if (pressed & 2) {
+        drag_drop(true); // before a menu goes up
         right_mouse_down(x, y);
         prev_x = x;
         prev_y = y;
@@ -81,6 +130,7 @@ static bool mouse(void) { // returns true when quit selected
             right_mouse_move(x, y);
         }
     }
+    hover(!(mb & 2) && !drag_carrying() && puzzle_movable(x, y)); // not while a menu's up
     return puzzle_quit;
 }
 
@@ -91,12 +141,17 @@ void mouse_init(void) {
     xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, height_px, 11);
     xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, xram_data_ptr, MOUSE_PTR_DATA);
     xram0_struct_set(MOUSE_PTR_STRUCT, vga_mode3_config_t, xram_palette_ptr, 0xFFFF);
+    hovering = false;
     
     draw_mouse_ptr();
+    draw_mouse_palette();
     xreg_vga_mode(3, 3, MOUSE_PTR_STRUCT, 2); // mouse pointer on (topmost) layer 2
     xreg_ria_mouse(MOUSE_INPUT_STRUCT);
 }
 
 void mouse_loop(void) {
+    SESSION_START(&sx, &sy, &mb, &mx, &my);
     while (!mouse());
+    SESSION_END();
+    INSTR_LOG();
 }
\ No newline at end of file
@@ -14,24 +14,41 @@
 // graphics 
     #define CANVAS_WIDTH 320
     #define CANVAS_HEIGHT 240
-    // XRAM locations
+    #define BITMAP_STRIDE (CANVAS_WIDTH / 2) // 4 bits per pixel
+    // XRAM map.  Regions are chained from their neighbours rather than hard-coded, so a different canvas mode
+    // only needs CANVAS_WIDTH/CANVAS_HEIGHT changing. Anything between XRAM_FREE_START and XRAM_FREE_END is
+    // handed out by the allocator in xram.c - never use a fixed address in that window
     // BITMAP DATA (320x240 x 4 bits) in XRAM from 0x0000 to 0x95FF
     #define BITMAP_DATA 0x0000
+    #define BITMAP_SIZE ((unsigned)BITMAP_STRIDE * CANVAS_HEIGHT) // unsigned: 38400 overflows a cc65 int
     // PALETTE DATA (16 x 16 bits) in XRAM from 0x9600 to 0x961F
     // follows on directly after BITMAP_DATA, so can be loaded by same read_xram() call
-    #define PALETTE_DATA 0x9600
-    // 0x9620 to 0xEC4F unallocated, and can be used for off-screen bitmap copies
-    // CHARACTER_DATA (80 x 30 chars x 16 bits) in XRAM from 0xEC50 to 0xFF0F
+    #define PALETTE_DATA (BITMAP_DATA + BITMAP_SIZE)
+    #define PALETTE_SIZE 0x0020
+    #define PALETTE_ALPHA 0x20 // in the low byte of a palette word: clear, and the colour is see-through
+    // 0x9620 to 0xEC1F free window, managed by xram_alloc()
+    #define XRAM_FREE_START (PALETTE_DATA + PALETTE_SIZE)
+    #define XRAM_FREE_END CHARACTER_DATA
+    // fixed-size regions taken from the window at start-up or puzzle load time, so an over-committed map fails at
+    // compile time (xram.c). Add a feature's region here rather than making xram.h include the feature
+    #define HINT_TABLE_ENTRIES 2048 // Hint's transposition table: 4 bytes per position
+    #define HINT_TABLE_SIZE (HINT_TABLE_ENTRIES * 4)
+    #define XRAM_BUDGET (HINT_TABLE_SIZE)
+    // remaining regions are packed down from the top of XRAM
+    // CHARACTER_DATA (80 x 30 chars x 16 bits) in XRAM from 0xEC20 to 0xFEDF
     // for the 40 x 30  character data overlaying the puzzles (menu and Moves count)
-    // only the first half of the CHARACTER_DATA XRAM is used: from EC50 to F5AF
-    #define CHARACTER_DATA 0xEC50
+    // only the first half of the CHARACTER_DATA XRAM is used: from EC20 to F57F
+    #define CHARACTER_SIZE (80 * 30 * 2)
+    #define CHARACTER_DATA (MOUSE_PTR_PALETTE - CHARACTER_SIZE)
+    // MOUSE POINTER PALETTE (17 x 16 bits) from 0xFEE0 to 0xFF01: its colours over a piece that can move
+    #define MOUSE_PTR_PALETTE (MOUSE_PTR_DATA - 0x0030)
     // MOUSE POINTER DATA (11x11 x 8 bits) from 0xFF10 to 0xFF88
-    #define MOUSE_PTR_DATA 0xFF10
+    #define MOUSE_PTR_DATA (KEYBOARD_STRUCT - 0x0080)
     // keyboard data from 0xFF90 to 0xFFAF
-    #define KEYBOARD_STRUCT 0xFF90
-    #define CHARACTER_STRUCT 0xFFB0
-    #define BITMAP_STRUCT 0xFFD0
-    #define MOUSE_PTR_STRUCT 0xFFE0
+    #define KEYBOARD_STRUCT (CHARACTER_STRUCT - 0x0020)
+    #define CHARACTER_STRUCT (BITMAP_STRUCT - 0x0020)
+    #define BITMAP_STRUCT (MOUSE_PTR_STRUCT - 0x0010)
+    #define MOUSE_PTR_STRUCT (MOUSE_INPUT_STRUCT - 0x0010)
 
 // mouse
     // Mouse speed divider
@@ -2,16 +2,17 @@
 
 #include "puzzle.h"
 #include "gfx.h"
-
-enum Direction {
-    NONE,
-    LEFT,
-    UP,
-    RIGHT,
-    DOWN
-};
+#include "xram.h"
+#include "hint.h"
+#include "demo.h"
+#include "atlas.h"
+#include "drag.h"
+#include "builtin.h"
+#include "session.h"
+#include "instrument.h"
 
 extern char instructions[6][27];
+extern char quick_prompt[QUICK_SLOTS][QUICK_PROMPT];
 extern uint8_t first_unused_puzz_number;
 
 const char puzz_identifier[17] = "PUZZ_RP6502_V1.0";
@@ -19,22 +20,57 @@ char puzzle_filename[16];
 char line_buffer[MAX_LINE];
 bool puzzle_quit;
 
-static uint8_t grid[MAX_DOWN][MAX_ACROSS];
-static uint8_t goal[MAX_DOWN][MAX_ACROSS];
-static uint8_t move_list[MAX_PIECES][4];
+uint8_t grid[MAX_DOWN][MAX_ACROSS]; // grid, goal, move_list and the layout are shared with hint.c
+uint8_t goal[MAX_DOWN][MAX_ACROSS];
+uint8_t move_list[MAX_PIECES][4];
+int top_left_x, top_left_y;
+uint8_t squares_across, squares_down, square_width, square_height, slide;
 
-static int top_left_x, top_left_y, moves, start_moves;
-static uint8_t squares_across, squares_down, square_width, square_height, slide, moves_col, moves_row, moves_fg, moves_bg;
+static int moves, start_moves;
+static uint8_t moves_col, moves_row, moves_fg, moves_bg;
 static char puzzle_name[14]; // used when saving puzzle
+static char moves_digits[MOVES_DIGITS + 1]; // right-aligned decimal Moves: count, kept in step with moves
+// while shuffling, pieces move on grid only: no drawing or counting
+static bool deferred;
+// how far each piece has moved since the load, so atlas.c can find its picture
+int8_t delta_row[MAX_PIECES], delta_col[MAX_PIECES];
+// the deltas the screen shows, while grid changes without drawing (Shuffle, a drag, a quick load). draw_moved()
+// then moves each piece's picture by the difference
+static int8_t shown_row[MAX_PIECES], shown_col[MAX_PIECES];
+#define MOVED_ROW(piece) (delta_row[piece] - shown_row[piece])
+#define MOVED_COL(piece) (delta_col[piece] - shown_col[piece])
+static uint8_t sources[MAX_DOWN * MAX_ACROSS / 8], drawn[MAX_DOWN * MAX_ACROSS / 8]; // one bit per square
+#define SQUARE(row, col) ((row) * MAX_ACROSS + (col))
+#define BIT_SET(set, i) (set[(i) >> 3] |= 1 << ((i) & 7))
+#define BIT_TEST(set, i) (set[(i) >> 3] & 1 << ((i) & 7))
+// dragging a piece: its shape relative to its bounding box, and the clicks found to take it where it's dropped.
+// path_reached has a square for each position of the box: the search level it was reached at (from 1) in the
+// top 5 bits, and the direction of the click that reached it in the bottom 3
+static const int8_t step_row[5] = { 0, 0, -1, 0, 1 }, step_col[5] = { 0, -1, 0, 1, 0 };
+static uint8_t path_row[PATH_MAX_SQUARES], path_col[PATH_MAX_SQUARES];
+static uint8_t path_squares, path_top, path_left, path_height, path_width;
+static uint8_t path_reached[MAX_DOWN][MAX_ACROSS];
+static uint8_t path[PATH_MAX_MOVES];
+// for each piece and direction (LEFT to DOWN), how many of its squares have the edge, a wall or another piece next
+// to them that way: it can move that way when the count is 0. set_square() keeps the counts up to date a square
+// at a time, so can_move() doesn't have to scan the grid
+static uint8_t blocked[MAX_PIECES][4];
+// quick-save slots in the free XRAM window, taken after the atlas at each load: see puzzle.h
+static unsigned quick = XRAM_NONE;
+static unsigned quick_size;
+static uint8_t quick_mark, quick_pieces;
+// the canvas rectangle a cropped file holds (see puzzle.h): crop_width is 0 for a whole canvas
+static int crop_left, crop_top, crop_width, crop_height;
+static uint8_t crop_colour;
 
 // read line from text file to line_buffer. check it's at least n chars long. abort with error on failure
 // also prune any comments (starting with semicolon) and trailing whitespace
 void read_line_n(FILE * fp, uint8_t n, char *puzzle_filename) {
     char * c;
 
-    if (!fgets(line_buffer, MAX_LINE, fp)) {
+    if (fp ? !fgets(line_buffer, MAX_LINE, fp) : !builtin_gets(line_buffer, MAX_LINE)) { // NULL: the built-in header
         printf("Unexpected EOF reading %s\n", puzzle_filename);
-        fclose(fp);
+        if (fp) fclose(fp);
         exit(1);
     }
     c = strchr(line_buffer, ';'); // check for comment
@@ -46,7 +82,7 @@ void read_line_n(FILE * fp, uint8_t n, char *puzzle_filename) {
 
     if (strlen(line_buffer) < n) {
         printf("Line in %s too short: %s\n", puzzle_filename, line_buffer);
-        fclose(fp);
+        if (fp) fclose(fp);
         exit(1);
     }
 }
@@ -62,10 +98,35 @@ void show_grid(uint8_t g[MAX_DOWN][MAX_ACROSS]) {
     printf("\n");
 }
 
+// draw the whole Moves: counter from moves. Only needed when a puzzle is (re)started
+static void show_score(void) {
+    uint8_t i;
+    unsigned n;
+    n = moves > MOVES_MAX ? MOVES_MAX : moves;
+    i = MOVES_DIGITS;
+    do {
+        moves_digits[--i] = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    while (i) {
+        moves_digits[--i] = ' ';
+    }
+    moves_digits[MOVES_DIGITS] = '\0';
+    text_at(moves_row, moves_col, moves_fg, moves_bg, "Moves:");
+    text_at(moves_row, moves_col + 6, moves_fg, moves_bg, moves_digits);
+}
+
+// count a move. The counter is incremented digit by digit, and only the character cells that change are rewritten
 static void update_score(void) {
-    moves++;
-    sprintf(line_buffer, "Moves:%4u", moves);
-    text_at(moves_row, moves_col, moves_fg, moves_bg, line_buffer);
+    uint8_t i;
+    if (deferred) return;
+    if (++moves > MOVES_MAX) return; // display stops at 9999, but moves keeps counting for puzzle_save()
+    i = MOVES_DIGITS - 1;
+    while (moves_digits[i] == '9') {
+        moves_digits[i--] = '0';
+    }
+    moves_digits[i] = moves_digits[i] == ' ' ? '1' : moves_digits[i] + 1;
+    text_at(moves_row, moves_col + 6 + i, moves_fg, moves_bg, moves_digits + i);
 }
 
 static void check_if_complete(void) {
@@ -82,22 +143,160 @@ static void check_if_complete(void) {
     }    
 }
 
+// add (count 1) or take away (count -1) what the square at (row, col) adds to its piece's blocked counts
+static void count_square(uint8_t row, uint8_t col, int8_t count) {
+    uint8_t piece, next;
+    piece = grid[row][col];
+    if (!piece || piece == 255) return;
+    next = col ? grid[row][col - 1] : 255;
+    if (next && next != piece) blocked[piece][LEFT - 1] += count;
+    next = row ? grid[row - 1][col] : 255;
+    if (next && next != piece) blocked[piece][UP - 1] += count;
+    next = col < squares_across - 1 ? grid[row][col + 1] : 255;
+    if (next && next != piece) blocked[piece][RIGHT - 1] += count;
+    next = row < squares_down - 1 ? grid[row + 1][col] : 255;
+    if (next && next != piece) blocked[piece][DOWN - 1] += count;
+}
+
+// the square and the ones next to it: the only counts that changing what's on it can affect
+static void count_around(uint8_t row, uint8_t col, int8_t count) {
+    count_square(row, col, count);
+    if (col) count_square(row, col - 1, count);
+    if (row) count_square(row - 1, col, count);
+    if (col < squares_across - 1) count_square(row, col + 1, count);
+    if (row < squares_down - 1) count_square(row + 1, col, count);
+}
+
+// change one square of a started puzzle
+static void set_square(uint8_t row, uint8_t col, uint8_t piece) {
+    count_around(row, col, -1);
+    grid[row][col] = piece;
+    count_around(row, col, 1);
+}
+
+static void count_all(void) {
+    uint8_t row, col;
+    memset(blocked, 0, sizeof(blocked));
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            count_square(row, col, 1);
+        }
+    }
+}
+
+// room for QUICK_SLOTS slots of this puzzle, all empty. Without room, Save and Load in the Slots menu do nothing
+static void quick_reserve(void) {
+    uint8_t row, col, slot;
+    quick_pieces = 0;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            if (grid[row][col] != 255 && grid[row][col] > quick_pieces) quick_pieces = grid[row][col];
+        }
+    }
+    quick_size = QUICK_HEADER + quick_pieces * QUICK_PIECE + squares_down * squares_across;
+    quick_mark = xram_mark();
+    quick = xram_alloc("quick slots", QUICK_SLOTS * quick_size, 1);
+    for (slot = 0; slot < QUICK_SLOTS; slot++) {
+        if (quick != XRAM_NONE) {
+            RIA.addr0 = quick + slot * quick_size;
+            RIA.step0 = 1;
+            RIA.rw0 = 0;
+        }
+        sprintf(quick_prompt[slot], "Load %u", slot + 1);
+    }
+}
+
+// the next number on a **CROPPED** line, or -1 if there isn't one
+static int crop_value(char * s) {
+    s = strtok(s, " ,");
+    return s ? atoi(s) : -1;
+}
+
+// up to 0x7FFF bytes per read_xram()
+static void read_block(unsigned addr, unsigned n, int fd) {
+    unsigned k;
+    while (n) {
+        k = n > 0x7FFF ? 0x7FFF : n;
+        read_xram(addr, k, fd);
+        addr += k;
+        n -= k;
+    }
+}
+
+// the bitmap and palette, with fd just past the **CANVAS** or **CROPPED** line. Around a cropped rectangle the
+// bitmap is filled a row at a time, and the rectangle's rows are read straight into place
+static void read_canvas(int fd) {
+    unsigned row_addr, i, left, right;
+    uint8_t fill;
+    int y;
+    if (!crop_width) {
+        read_block(BITMAP_DATA, BITMAP_SIZE + PALETTE_SIZE, fd);
+        return;
+    }
+    fill = crop_colour | crop_colour << 4;
+    left = crop_left >> 1;
+    right = (crop_left + crop_width) >> 1;
+    RIA.step0 = 1;
+    row_addr = BITMAP_DATA;
+    for (y = 0; y < CANVAS_HEIGHT; y++, row_addr += BITMAP_STRIDE) {
+        RIA.addr0 = row_addr;
+        if (y < crop_top || y >= crop_top + crop_height) {
+            for (i = 0; i < BITMAP_STRIDE; i++) RIA.rw0 = fill;
+            continue;
+        }
+        if (crop_width == CANVAS_WIDTH) { // whole rows: the rectangle is one block
+            read_block(row_addr, (unsigned)crop_height * BITMAP_STRIDE, fd);
+            y += crop_height - 1;
+            row_addr += (unsigned)(crop_height - 1) * BITMAP_STRIDE;
+            continue;
+        }
+        for (i = 0; i < left; i++) RIA.rw0 = fill;
+        RIA.addr0 = row_addr + right;
+        for (i = right; i < BITMAP_STRIDE; i++) RIA.rw0 = fill;
+        read_xram(row_addr + left, right - left, fd);
+    }
+    read_xram(PALETTE_DATA, PALETTE_SIZE, fd);
+}
+
+static void start_position(void) {
+    uint8_t i, j;
+    for (i = 0; i < MAX_PIECES; i++) {
+		for (j = 0; j < 4; j++) {
+			move_list[i][j] = j + 1;
+        }
+    }
+    memset(delta_row, 0, sizeof(delta_row));
+    memset(delta_col, 0, sizeof(delta_col));
+    count_all();
+    moves = start_moves;
+    show_score(); // overwrites any moves count left when restarting
+}
+
 void puzzle_load(void) { // aborts with error message, or returns silently on success
     FILE * fp;
     int fd; // file descriptor for open()
     uint8_t i, j;
     char * c;
+    bool builtin;
 
+    INSTR_BEGIN(INSTR_LOAD);
+    hint_stop();
     puzzle_quit = false;
-    fp = fopen(puzzle_filename, "r");
-    if (fp == NULL) {
-        printf("File not found error\n  puzzle_load(\"%s\")\n", puzzle_filename);
-        exit(1);
+    builtin = builtin_fresh(atoi(puzzle_filename));
+    if (builtin) {
+        fp = NULL; // read_line_n() reads the built-in header
+        builtin_rewind();
+    } else {
+        fp = fopen(puzzle_filename, "r");
+        if (fp == NULL) {
+            printf("File not found error\n  puzzle_load(\"%s\")\n", puzzle_filename);
+            exit(1);
+        }
     }
     read_line_n(fp, 16, puzzle_filename); // 1st line of file is PUZZ identifier (and required minimum version number)
 	if (strncmp(line_buffer, "PUZZ_RP6502_V", 13)) {
         printf("%s missing %s identifier\n", puzzle_filename, puzz_identifier);
-        fclose(fp);
+        if (fp) fclose(fp);
         exit(1);
     }
     read_line_n(fp, 1, puzzle_filename);
@@ -146,60 +345,105 @@ void puzzle_load(void) { // aborts with error message, or returns silently on su
     read_line_n(fp, 1, puzzle_filename);
     moves_bg = (uint8_t)atoi(line_buffer);
     read_line_n(fp, 10, puzzle_filename); // 1st line of file is PUZZ identifier (and required minimum version number)
-	if (strncmp(line_buffer, "**CANVAS**", 10)) {
+    crop_width = 0;
+    if (!strncmp(line_buffer, CROP_MARK, CROP_MARK_SIZE)) {
+        crop_left = crop_value(line_buffer + CROP_MARK_SIZE);
+        crop_top = crop_value(NULL);
+        crop_width = crop_value(NULL);
+        crop_height = crop_value(NULL);
+        crop_colour = (uint8_t)crop_value(NULL);
+        if (crop_left < 0 || crop_left & 0x01 || crop_width <= 0 || crop_width & 0x01 ||
+            crop_left + crop_width > CANVAS_WIDTH || crop_top < 0 || crop_height <= 0 ||
+            crop_top + crop_height > CANVAS_HEIGHT || crop_colour > 15) {
+            printf("%s bad %s rectangle\n", puzzle_filename, CROP_MARK);
+            if (fp) fclose(fp);
+            exit(1);
+        }
+    } else if (strncmp(line_buffer, "**CANVAS**", 10)) {
         printf("%s missing **CANVAS** identifier\n", puzzle_filename);
-        fclose(fp);
+        if (fp) fclose(fp);
         exit(1);
     }
-    fclose(fp);
-
-    fd = open(puzzle_filename, O_RDONLY);
-    if (fd < 0) {
-        printf("File not found error\n  open(\"%s\", O_RDONLY)\n", puzzle_filename);
-        exit(1);
+    if (fp) fclose(fp);
+    if (quick != XRAM_NONE) { // the slots are above the atlas: give them back before it's built again
+        xram_release(quick_mark);
+        quick = XRAM_NONE;
     }
-    // read and discard up to **CANVAS**<CR><LF>
-    i = 0; // count of linefeeds
-    while (i < 2 * squares_down + 21) {
-        if (read(fd, line_buffer, 11) != 11) {            
-            printf("Error searching for **CANVAS** in %s\n", puzzle_filename);
-            close(fd);
+
+    if (builtin) {
+        builtin_load(); // the canvas is already in BITMAP_DATA
+    } else {
+        fd = open(puzzle_filename, O_RDONLY);
+        if (fd < 0) {
+            printf("File not found error\n  open(\"%s\", O_RDONLY)\n", puzzle_filename);
             exit(1);
         }
-        line_buffer[11] = '\0';
-        for (c = line_buffer; *c; c++) {
-            if (*c == '\n') {
-                i++;
+        // read and discard up to **CANVAS**<CR><LF>
+        i = 0; // count of linefeeds
+        while (i < 2 * squares_down + 21) {
+            if (read(fd, line_buffer, 11) != 11) {            
+                printf("Error searching for **CANVAS** in %s\n", puzzle_filename);
+                close(fd);
+                exit(1);
+            }
+            line_buffer[11] = '\0';
+            for (c = line_buffer; *c; c++) {
+                if (*c == '\n') {
+                    i++;
+                }
             }
         }
+        do {
+            read(fd, line_buffer, 1);
+        } while (line_buffer[0] != '\n');
+        // now we're at the start of the binary data for the image and palette
+        INSTR_OP();
+        read_canvas(fd);
+        demo_find(fd); // any solution track follows the palette
+        close(fd);
     }
-    do {
-        read(fd, line_buffer, 1);
-    } while (line_buffer[0] != '\n');
-    // now we're at the start of the binary data for the image and palette
-    read_xram(0, 0x4B00, fd); // 0x7FFF bytes maximum, so read first half of 0x9600 bytes
-    read_xram(0x4B00, 0x4B20, fd); // second half plus palette
-    close(fd);
-    for (i = 0; i < MAX_PIECES; i++) {
-		for (j = 0; j < 4; j++) {
-			move_list[i][j] = j + 1;
+    atlas_build();
+    if (builtin && !atlas_ready()) builtin_used(); // builtin.py won't build one in that can't be put back
+    quick_reserve();
+    start_position();
+#ifdef XRAM_REPORT
+    xram_report();
+#endif
+    INSTR_END();
+}
+
+// Puzzle menu Restart. With an atlas, grid goes back to how it was loaded and the board is redrawn from that,
+// without reading the file again
+void puzzle_restart(void) {
+    uint8_t row, col;
+    if (!atlas_ready()) {
+        puzzle_load();
+        return;
+    }
+    INSTR_BEGIN(INSTR_LOAD);
+    hint_stop();
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            grid[row][col] = atlas_start_piece(row, col);
         }
     }
-    n_chars_at(moves_row, moves_col, 0, 0, 10, ' '); // erase any moves count left when restarting
-    moves = start_moves - 1;
-    update_score();
+    start_position();
+    atlas_draw_board(true);
+    INSTR_END();
 }
 
 void puzzle_save(void) {
     int fd; // file descriptor for open()
     uint8_t i, j;
 
+    INSTR_BEGIN(INSTR_SAVE);
     sprintf(line_buffer, "%02u.puzz", first_unused_puzz_number);
     fd = open(line_buffer, O_CREAT | O_WRONLY);
     if (fd < 0) {
         printf("Couldn't create save file\n  open(\"%s\", O_CREAT | O_WRONLY)\n", line_buffer);
         exit(1);
     }
+    remove(MENU_CACHE); // the main menu has another file to list
     write(fd, puzz_identifier, strlen(puzz_identifier));
     sprintf(line_buffer, "\n%s\nSaved (%u moves)\n%u\n", puzzle_name, moves, moves);
     write(fd, line_buffer, strlen(line_buffer));
@@ -226,41 +470,16 @@ void puzzle_save(void) {
     sprintf(line_buffer, "%u\n%u\n%u\n%u\n%u\n", slide, moves_col, moves_row, moves_fg, moves_bg);
     write(fd, line_buffer, strlen(line_buffer));
     write(fd, "**CANVAS**\n", 11);
-    write_xram(0, 0x4B00, fd); // 0x7FFF bytes maximum, so read first half of 0x9600 bytes
-    write_xram(0x4B00, 0x4B20, fd); // second half plus palette
+    INSTR_OP();
+    write_xram(BITMAP_DATA, BITMAP_SIZE / 2, fd); // 0x7FFF bytes maximum, so write first half of 0x9600 bytes
+    write_xram(BITMAP_DATA + BITMAP_SIZE / 2, BITMAP_SIZE / 2 + PALETTE_SIZE, fd); // second half plus palette
     close(fd);
+    INSTR_END();
 }
 
 static bool can_move(uint8_t piece, int direction) {
-	uint8_t row, col, old;
-	for (row = 0; row < squares_down; row++) {
-		for (col = 0; col < squares_across; col++) {
-			if (piece == grid[row][col]) {    
-				switch (direction) {
-					case LEFT:
-						if (col == 0) return false;
-						old = grid[row][col - 1];
-						break;
-					case UP:
-						if (row == 0) return false;
-						old = grid[row - 1][col];
-						break;
-					case RIGHT:
-						if (col == squares_across - 1) return false;
-						old = grid[row][col + 1];
-						break;
-					case DOWN:
-						if (row == squares_down - 1) return false;
-						old = grid[row + 1][col];
-						break;
-                    default:
-                        return false;
-                }
-				if (old && (old != piece)) return false;
-            }
-        }
-    }
-	return true;
+    if (!piece || piece == 255 || direction < LEFT || direction > DOWN) return false;
+    return !blocked[piece][direction - 1];
 }
 
 static void sort_list (uint8_t piece, int move) {
@@ -340,24 +559,26 @@ static void move_one_piece(uint8_t piece, int direction) {
                 switch(direction) {
                     case LEFT:
                     case RIGHT:
-                        grid[row][col - inner_step] = piece;
-                        gfx_move(x, y, x - inner_step * square_width, y, square_width, square_height, 0);
+                        set_square(row, col - inner_step, piece);
+                        if (!deferred) gfx_move(x, y, x - inner_step * square_width, y, square_width, square_height, 0);
                         break;
                     case UP:
                     case DOWN:
-                        grid[row - inner_step][col] = piece;
-                        gfx_move(x, y, x, y - inner_step * square_height, square_width, square_height, 0);
+                        set_square(row - inner_step, col, piece);
+                        if (!deferred) gfx_move(x, y, x, y - inner_step * square_height, square_width, square_height, 0);
                         break;
                     default:
                         puts("Bad direction in move_one_piece()");
                         exit(1);
                 }
-                grid[row][col] = 0;
+                set_square(row, col, 0);
             }
             if (*inner == inner_last) break;
             *inner += inner_step;
         } 
     }
+    if (outer == &row) delta_col[piece] -= inner_step;
+    else delta_row[piece] -= inner_step;
 }
 
 static int move_piece(uint8_t piece) {
@@ -487,25 +708,418 @@ static void slide_pieces(uint8_t piece) {
     }
 }
 
-void puzzle_click(int x, int y) { // left mouse clicked at screen coordinate (x, y)
-    uint8_t piece;
+// grid square at screen coordinate (x, y), false if it's off the board
+bool board_square(int x, int y, uint8_t * row, uint8_t * col) {
     x -= top_left_x;
-    if (x >= 0) {
-        x /= square_width;
-        if (x < squares_across) {
-            y -= top_left_y;
-            if (y >= 0) {
-                y /= square_height;
-                if (y < squares_down) {
-                    piece = grid[y][x];
-                    if (piece && piece != 255) {
-                        if (!move_piece(piece) && slide == 2) {
-                            slide_pieces(piece);
-                        }
-                        check_if_complete();
+    y -= top_left_y;
+    if (x < 0 || y < 0) return false;
+    x /= square_width;
+    y /= square_height;
+    if (x >= squares_across || y >= squares_down) return false;
+    *row = y;
+    *col = x;
+    return true;
+}
+
+void puzzle_click(int x, int y) { // left mouse clicked at screen coordinate (x, y)
+    uint8_t piece, row, col;
+    INSTR_BEGIN(INSTR_CLICK);
+    hint_stop(); // before any square moves, so the highlight doesn't go with it
+    demo_stop();
+    if (board_square(x, y, &row, &col)) {
+        piece = grid[row][col];
+        if (piece && piece != 255) {
+            if (!move_piece(piece) && slide == 2) {
+                slide_pieces(piece);
+            }
+            check_if_complete();
+        }
+    }
+    INSTR_END();
+}
+
+// is there room for the piece's shape with its bounding box at (top, left)? Its own squares don't get in the way
+static bool path_fits(uint8_t piece, int8_t top, int8_t left) {
+    uint8_t i, g;
+    if (top < 0 || left < 0 || top + path_height > squares_down || left + path_width > squares_across) return false;
+    for (i = 0; i < path_squares; i++) {
+        g = grid[top + path_row[i]][left + path_col[i]];
+        if (g && g != piece) return false;
+    }
+    return true;
+}
+
+// where one click in direction takes the piece from (*top, *left), as move_piece() would slide it. False if it
+// can't go that way at all
+static bool path_step(uint8_t piece, uint8_t * top, uint8_t * left, uint8_t direction) {
+    int8_t t, l;
+    t = *top + step_row[direction];
+    l = *left + step_col[direction];
+    if (!path_fits(piece, t, l)) return false;
+    do {
+        *top = t;
+        *left = l;
+        t += step_row[direction];
+        l += step_col[direction];
+    } while (slide && path_fits(piece, t, l));
+    return true;
+}
+
+// fewest clicks that take the piece's bounding box from (top, left) to (to_top, to_left), with every other piece
+// where it is: a breadth-first search over the box's positions, a level at a time. Leaves the clicks' directions
+// in path[] and returns how many, or -1 if it can't get there in PATH_MAX_MOVES
+static int8_t path_find(uint8_t piece, uint8_t top, uint8_t left, uint8_t to_top, uint8_t to_left) {
+    uint8_t level, row, col, t, l, end_top, end_left, direction, moves_needed;
+    bool more;
+    memset(path_reached, 0, sizeof(path_reached));
+    path_reached[top][left] = 1 << 3;
+    for (level = 1, more = true; more && level <= PATH_MAX_MOVES && !path_reached[to_top][to_left]; level++) {
+        more = false;
+        for (row = 0; row + path_height <= squares_down; row++) {
+            for (col = 0; col + path_width <= squares_across; col++) {
+                if (path_reached[row][col] >> 3 != level) continue;
+                for (direction = LEFT; direction <= DOWN; direction++) {
+                    t = row;
+                    l = col;
+                    if (path_step(piece, &t, &l, direction) && !path_reached[t][l]) {
+                        path_reached[t][l] = (level + 1) << 3 | direction;
+                        more = true;
                     }
                 }
             }
         }
     }
+    if (!path_reached[to_top][to_left]) return -1;
+    moves_needed = (path_reached[to_top][to_left] >> 3) - 1;
+    row = to_top;
+    col = to_left;
+    for (level = moves_needed; level; level--) { // back along the ray each click came in on, to the level before
+        direction = path_reached[row][col] & 0x07;
+        path[level - 1] = direction;
+        end_top = row;
+        end_left = col;
+        do {
+            row -= step_row[direction];
+            col -= step_col[direction];
+            t = row;
+            l = col;
+            path_step(piece, &t, &l, direction);
+        } while (path_reached[row][col] >> 3 != level || t != end_top || l != end_left);
+    }
+    return moves_needed;
+}
+
+// is there a piece at screen coordinate (x, y) that can move on its own? Pushes (slide 2) aren't looked for
+bool puzzle_movable(int x, int y) {
+    uint8_t row, col, piece;
+    if (!board_square(x, y, &row, &col)) return false;
+    piece = grid[row][col];
+    return can_move(piece, LEFT) || can_move(piece, UP) || can_move(piece, RIGHT) || can_move(piece, DOWN);
+}
+
+// move piece the way a click would if it chose direction, or push with it for PUSH. Returns false, having moved
+// nothing, if that isn't a legal move
+bool puzzle_move(uint8_t piece, uint8_t direction) {
+    int before;
+    INSTR_BEGIN(INSTR_CLICK);
+    before = moves;
+    if (piece && piece != 255) {
+        if (direction == PUSH) {
+            if (slide == 2) slide_pieces(piece); // counts the move itself
+        } else if (can_move(piece, direction)) {
+            sort_list(piece, direction); // keep move_list as suggest_move() would have left it
+            do {
+                move_one_piece(piece, direction);
+            } while (slide && can_move(piece, direction));
+            update_score();
+        }
+    }
+    if (moves != before) check_if_complete();
+    INSTR_END();
+    return moves != before;
+}
+
+static void draw_square(int src_left, int src_top, uint8_t row, uint8_t col) {
+    gfx_move(src_left, src_top, top_left_x + col * square_width, top_left_y + row * square_height, square_width,
+        square_height, 0);
+}
+
+// what's on screen is grid as it is now: draw_moved() moves pictures from here
+static void show_deltas(void) {
+    memcpy(shown_row, delta_row, sizeof(shown_row));
+    memcpy(shown_col, delta_col, sizeof(shown_col));
+}
+
+// draw the squares from (row, col) back along where each one's picture has come from, until one that's left
+// empty (gfx_move() fills it with 0 as it goes), or with scratch, round a cycle back to (row, col) itself, whose
+// picture is put aside in scratch first
+static void draw_back_from(uint8_t row, uint8_t col, unsigned scratch) {
+    uint8_t first_row, first_col, src_row, src_col, piece;
+    first_row = row;
+    first_col = col;
+    if (scratch != XRAM_NONE) {
+        gfx_move(top_left_x + col * square_width, top_left_y + row * square_height, XRAM_LEFT(scratch),
+            XRAM_TOP(scratch), square_width, square_height, 0);
+    }
+    while (true) {
+        piece = grid[row][col];
+        BIT_SET(drawn, SQUARE(row, col));
+        src_row = row - MOVED_ROW(piece);
+        src_col = col - MOVED_COL(piece);
+        if (scratch != XRAM_NONE && src_row == first_row && src_col == first_col) {
+            draw_square(XRAM_LEFT(scratch), XRAM_TOP(scratch), row, col);
+            return;
+        }
+        draw_square(top_left_x + src_col * square_width, top_left_y + src_row * square_height, row, col);
+        piece = grid[src_row][src_col];
+        if (!piece || piece == 255) return;
+        row = src_row;
+        col = src_col;
+    }
+}
+
+// draw every square whose piece has moved since show_deltas(), moving each square's picture once.
+// Chains start at a square that was empty before: nothing there needs keeping. What's left moved round cycles,
+// each of which goes through scratch once. One piece on its own only makes chains
+static void draw_moved(unsigned scratch) {
+    uint8_t row, col, piece;
+    memset(sources, 0, sizeof(sources));
+    memset(drawn, 0, sizeof(drawn));
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            piece = grid[row][col];
+            if (piece && piece != 255) BIT_SET(sources, SQUARE(row - MOVED_ROW(piece), col - MOVED_COL(piece)));
+        }
+    }
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            piece = grid[row][col];
+            if (piece && piece != 255 && !BIT_TEST(sources, SQUARE(row, col))) draw_back_from(row, col, XRAM_NONE);
+        }
+    }
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            piece = grid[row][col];
+            if (piece && piece != 255 && !BIT_TEST(drawn, SQUARE(row, col)) && (MOVED_ROW(piece) || MOVED_COL(piece))) {
+                draw_back_from(row, col, scratch);
+            }
+        }
+    }
+}
+
+// Puzzle menu Shuffle: a new start, SHUFFLE_MOVES random clicks (and pushes, with slide 2) away from the current
+// position. The clicks only change grid, then the board is redrawn from the atlas, or without one, draw_moved()
+// moves each square of the picture once
+void puzzle_shuffle(void) {
+    unsigned tries, n, scratch, seed;
+    uint8_t mark, row, col, piece, last, direction;
+    hint_stop();
+    demo_stop();
+    mark = xram_mark();
+    scratch = XRAM_NONE;
+    if (!atlas_ready()) {
+        scratch = xram_alloc("shuffle square", square_height * BITMAP_STRIDE, 1); // a square at XRAM_TOP/XRAM_LEFT
+        if (scratch == XRAM_NONE) return; // squares too tall to put one aside: leave the puzzle as it is
+        show_deltas();
+    }
+    INSTR_BEGIN(INSTR_LOAD);
+    seed = (unsigned)lrand();
+    SESSION_SEED_USE(&seed); // recorded, or the recorded one
+    srand(seed);
+    deferred = true;
+    last = 0;
+    for (tries = n = 0; n < SHUFFLE_MOVES && tries < SHUFFLE_TRIES; tries++) {
+        row = rand() % squares_down;
+        col = rand() % squares_across;
+        piece = grid[row][col];
+        if (!piece || piece == 255 || piece == last) continue; // the same piece again would often just go back
+        if (slide == 2 && !(rand() & 7)) {
+            slide_pieces(piece);
+        } else {
+            direction = LEFT + (rand() & 3);
+            if (!can_move(piece, direction)) continue;
+            do {
+                move_one_piece(piece, direction);
+            } while (slide && can_move(piece, direction));
+        }
+        last = piece;
+        n++;
+    }
+    deferred = false;
+    if (atlas_ready()) {
+        atlas_draw_board(false);
+    } else {
+        draw_moved(scratch);
+        xram_release(mark);
+    }
+    moves = 0;
+    show_score();
+    INSTR_END();
+}
+
+// keep the position in a slot: moves, then each piece's move_list (packed 2 bits an entry) and deltas, then grid
+void puzzle_quick_save(uint8_t slot) {
+    uint8_t row, col, piece;
+    if (quick == XRAM_NONE) return;
+    INSTR_BEGIN(INSTR_SAVE);
+    hint_stop();
+    demo_stop();
+    INSTR_OP();
+    RIA.addr0 = quick + slot * quick_size;
+    RIA.step0 = 1;
+    RIA.rw0 = 1;
+    RIA.rw0 = moves & 0xFF;
+    RIA.rw0 = moves >> 8;
+    for (piece = 1; piece <= quick_pieces; piece++) {
+        RIA.rw0 = (move_list[piece][0] - 1) << 6 | (move_list[piece][1] - 1) << 4 |
+            (move_list[piece][2] - 1) << 2 | (move_list[piece][3] - 1);
+        RIA.rw0 = delta_row[piece];
+        RIA.rw0 = delta_col[piece];
+    }
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            RIA.rw0 = grid[row][col];
+        }
+    }
+    sprintf(quick_prompt[slot], "Load %u (%u)", slot + 1, moves > MOVES_MAX ? MOVES_MAX : moves);
+    INSTR_END();
+}
+
+// back to a slot's position. Only squares whose piece, or whose piece's picture, is different are drawn: from the
+// atlas, or without one, draw_moved() moves the pictures that changed from where they are now
+void puzzle_quick_load(uint8_t slot) {
+    unsigned addr, scratch;
+    uint8_t row, col, piece, was, mark, i;
+    uint8_t row_pieces[MAX_ACROSS];
+    if (quick == XRAM_NONE) return;
+    addr = quick + slot * quick_size;
+    RIA.addr0 = addr;
+    RIA.step0 = 1;
+    if (!RIA.rw0) return; // nothing saved in it
+    mark = xram_mark();
+    scratch = XRAM_NONE;
+    if (!atlas_ready()) {
+        scratch = xram_alloc("quick square", square_height * BITMAP_STRIDE, 1); // for draw_moved() cycles
+        if (scratch == XRAM_NONE) return;
+    }
+    INSTR_BEGIN(INSTR_LOAD);
+    hint_stop();
+    demo_stop();
+    INSTR_OP();
+    show_deltas();
+    RIA.addr0 = addr + 1; // past the flag: the stops above can move the address
+    RIA.step0 = 1;
+    moves = RIA.rw0;
+    moves |= RIA.rw0 << 8;
+    for (piece = 1; piece <= quick_pieces; piece++) {
+        was = RIA.rw0;
+        for (i = 4; i--; was >>= 2) {
+            move_list[piece][i] = (was & 0x03) + 1;
+        }
+        delta_row[piece] = RIA.rw0;
+        delta_col[piece] = RIA.rw0;
+    }
+    addr += QUICK_HEADER + quick_pieces * QUICK_PIECE;
+    for (row = 0; row < squares_down; row++) {
+        RIA.addr0 = addr; // drawing uses the RIA's address registers
+        RIA.step0 = 1;
+        for (col = 0; col < squares_across; col++) {
+            row_pieces[col] = RIA.rw0;
+        }
+        addr += squares_across;
+        for (col = 0; col < squares_across; col++) {
+            piece = row_pieces[col];
+            was = grid[row][col];
+            if (piece != was) set_square(row, col, piece);
+            if (atlas_ready() && (piece != was || (piece && piece != 255 && (MOVED_ROW(piece) || MOVED_COL(piece))))) {
+                atlas_draw(row, col, false);
+            }
+        }
+    }
+    if (!atlas_ready()) {
+        draw_moved(scratch);
+    }
+    xram_release(mark);
+    show_score();
+    INSTR_END();
+}
+
+// the piece's squares relative to its bounding box, into path_row and path_col. False if it has too many
+static bool path_shape(uint8_t piece) {
+    uint8_t row, col, bottom, right;
+    path_top = path_left = 255;
+    bottom = right = path_squares = 0;
+    for (row = 0; row < squares_down; row++) {
+        for (col = 0; col < squares_across; col++) {
+            if (grid[row][col] != piece) continue;
+            if (path_squares == PATH_MAX_SQUARES) return false;
+            if (path_top == 255) path_top = row;
+            if (col < path_left) path_left = col;
+            if (col > right) right = col;
+            bottom = row;
+            path_row[path_squares] = row;
+            path_col[path_squares++] = col;
+        }
+    }
+    for (row = 0; row < path_squares; row++) {
+        path_row[row] -= path_top;
+        path_col[row] -= path_left;
+    }
+    path_height = bottom - path_top + 1;
+    path_width = right - path_left + 1;
+    return true;
+}
+
+// left button pressed at (from_x, from_y) and released at (to_x, to_y). Released on the same square, it's a click
+// (unless the piece was carried away and back). Otherwise the piece pressed on goes, by the fewest clicks it can,
+// so that the square of it that was pressed ends up where the button was released. grid changes in one go, the
+// Moves: counter goes up by the number of clicks, and the piece is drawn once where it ends up. A piece carried
+// on the pointer's layer (drag.c) is left for the caller to put back, unless it moves
+void puzzle_drag(int from_x, int from_y, int to_x, int to_y) {
+    uint8_t piece, row, col, to_row, to_col, to_top, to_left, i;
+    int8_t n;
+    if (!board_square(from_x, from_y, &row, &col)) return;
+    if (!board_square(to_x, to_y, &to_row, &to_col)) return; // dropped off the board: nothing happens
+    if (row == to_row && col == to_col) {
+        if (!drag_carrying()) puzzle_click(from_x, from_y); // carried there and back, it's put back as it was
+        return;
+    }
+    piece = grid[row][col];
+    if (!piece || piece == 255 || !path_shape(piece)) return;
+    if (to_row < row - path_top || to_col < col - path_left) return;
+    to_top = to_row - (row - path_top);
+    to_left = to_col - (col - path_left);
+    if (to_top + path_height > squares_down || to_left + path_width > squares_across) return;
+    INSTR_BEGIN(INSTR_CLICK);
+    hint_stop();
+    demo_stop();
+    n = path_find(piece, path_top, path_left, to_top, to_left);
+    if (n > 0) {
+        drag_drop(!atlas_ready()); // draw_moved() moves its picture from where it was, the atlas redraws it
+        for (i = 0; i < n; i++) {
+            sort_list(piece, path[i]); // move_list as the clicks would have left it
+        }
+        if (!atlas_ready()) show_deltas();
+        for (i = 0; i < path_squares; i++) {
+            set_square(path_top + path_row[i], path_left + path_col[i], 0);
+        }
+        for (i = 0; i < path_squares; i++) {
+            set_square(to_top + path_row[i], to_left + path_col[i], piece);
+        }
+        delta_row[piece] += to_top - path_top;
+        delta_col[piece] += to_left - path_left;
+        if (atlas_ready()) {
+            for (i = 0; i < path_squares; i++) {
+                atlas_draw(path_top + path_row[i], path_left + path_col[i], false);
+                atlas_draw(to_top + path_row[i], to_left + path_col[i], false);
+            }
+        } else {
+            draw_moved(XRAM_NONE);
+        }
+        while (n--) {
+            update_score();
+        }
+        check_if_complete();
+    }
+    INSTR_END();
 }
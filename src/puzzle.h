@@ -1,12 +1,53 @@
 #ifndef _PUZZLE_
     #include "puzz.h"
-    // bitmap copies to/from following coordinates which target the unallocated RAM above the bitmap palette
-    #define OFF_SCREEN_TOP 240
-    #define OFF_SCREEN_LEFT 64
+    // Moves: counter is "Moves:" followed by this many right-aligned digits
+    #define MOVES_DIGITS 4
+    #define MOVES_MAX 9999
+    // Shuffle makes this many random moves, giving up after SHUFFLE_TRIES picks of a piece and direction
+    #define SHUFFLE_MOVES 2000
+    #define SHUFFLE_TRIES 16000u
+    // dragging a piece finds a way of at most PATH_MAX_MOVES clicks, for pieces of up to PATH_MAX_SQUARES squares
+    #define PATH_MAX_MOVES 30
+    #define PATH_MAX_SQUARES 16
+    // Slots menu: quick saves of the position in the free XRAM window, kept until another puzzle is loaded. A slot
+    // is a used byte and moves (QUICK_HEADER), a move_list byte and deltas for each piece (QUICK_PIECE), then grid
+    #define QUICK_SLOTS 3 // menu.c has a Save and a Load item for each
+    #define QUICK_HEADER 3
+    #define QUICK_PIECE 3
+    #define QUICK_PROMPT 14 // "Load 3 (9999)"
+    // a cropped canvas: "**CROPPED** left top width height colour" in place of the **CANVAS** line, then only that
+    // rectangle's rows of the bitmap (width / 2 bytes each), then the palette. The rest of the bitmap is colour.
+    // left and width are even, so each row is whole bytes
+    #define CROP_MARK "**CROPPED**"
+    #define CROP_MARK_SIZE 11
+    // main menu: the finished screen and the ##.puzz numbers on it, so it's only built by opening every file when
+    // they've changed. The file is the id, num_files, first_unused_puzz_number and file_number[44], then the screen
+    #define MENU_CACHE "puzz.menu"
+    #define MENU_CACHE_ID "PUZZ_MENU_V1"
+    #define MENU_CACHE_ID_SIZE 12
+    #define MENU_CACHE_HEADER (MENU_CACHE_ID_SIZE + 2 + 44)
+    // off-screen bitmap copies go to regions from xram_alloc(), addressed with XRAM_TOP() and XRAM_LEFT()
+
+    enum Direction {
+        NONE,
+        LEFT,
+        UP,
+        RIGHT,
+        DOWN,
+        PUSH // slide_pieces(), in a solution track
+    };
     
     void puzzle_load(void);
+    void puzzle_restart(void); // Puzzle menu Restart: puzzle_load() unless there's an atlas to redraw from
     void puzzle_save(void);
     void puzzle_click(int x, int y);
+    void puzzle_drag(int from_x, int from_y, int to_x, int to_y); // left button press to release
+    bool board_square(int x, int y, uint8_t * row, uint8_t * col); // grid square at screen (x, y)
+    bool puzzle_movable(int x, int y); // for the pointer's hover colours: nothing is scanned
+    void puzzle_shuffle(void); // Puzzle menu Shuffle
+    void puzzle_quick_save(uint8_t slot); // Slots menu
+    void puzzle_quick_load(uint8_t slot);
+    bool puzzle_move(uint8_t piece, uint8_t direction); // one move of a solution track
     void read_line_n(FILE * fp, uint8_t n, char *puzzle_filename);
     
     #define _PUZZLE_
@@ -0,0 +1,180 @@
+// recording and replaying a play session's mouse input for PUZZ on RP6502: see session.h
+
+#include "session.h"
+
+#if defined(SESSION_RECORDING) || defined(SESSION_REPLAYING)
+
+extern char puzzle_filename[];
+
+static int fd = -1; // -1 when there's nothing to record to or replay from
+static uint8_t buffer[SESSION_BUFFER];
+static unsigned buffered;
+static uint8_t last_vsync, last_buttons, last_x, last_y;
+static unsigned frames; // since the last record
+
+// the mouse's buttons and counters as mouse() last saw them, and frames counted from now
+static void start_counting(uint8_t buttons, uint8_t x, uint8_t y) {
+    last_vsync = RIA.vsync;
+    last_buttons = buttons;
+    last_x = x;
+    last_y = y;
+    frames = 0;
+}
+
+static void count_frames(void) {
+    uint8_t elapsed;
+    elapsed = RIA.vsync - last_vsync;
+    last_vsync += elapsed;
+    frames += elapsed;
+}
+
+#ifdef SESSION_RECORDING
+
+static void flush(void) {
+    if (fd >= 0 && buffered) write(fd, buffer, buffered);
+    buffered = 0;
+}
+
+static void put(uint8_t wait, uint8_t a, uint8_t b, uint8_t buttons) {
+    if (buffered == SESSION_BUFFER) flush();
+    buffer[buffered++] = wait;
+    buffer[buffered++] = a;
+    buffer[buffered++] = b;
+    buffer[buffered++] = buttons;
+}
+
+void session_start(int * x, int * y, uint8_t * buttons, uint8_t * counter_x, uint8_t * counter_y) {
+    char name[8];
+    sprintf(name, "%.2s%s", puzzle_filename, SESSION_SUFFIX);
+    fd = open(name, O_CREAT | O_WRONLY | O_TRUNC);
+    buffered = 0;
+    if (fd < 0) return;
+    write(fd, SESSION_MARK, SESSION_MARK_SIZE);
+    put(*x & 0xFF, *x >> 8, *y & 0xFF, *y >> 8);
+    put(*buttons, *counter_x, *counter_y, 0);
+    start_counting(*buttons, *counter_x, *counter_y); // so a change before the first poll is recorded too
+}
+
+void session_input(uint8_t * buttons, uint8_t * x, uint8_t * y) {
+    if (fd < 0) return;
+    count_frames();
+    while (frames >= 255) {
+        put(255, 0, 0, last_buttons);
+        frames -= 255;
+    }
+    if (*buttons != last_buttons || *x != last_x || *y != last_y) {
+        put(frames, *x - last_x, *y - last_y, *buttons);
+        last_buttons = *buttons;
+        last_x = *x;
+        last_y = *y;
+        frames = 0;
+    }
+}
+
+void session_seed(unsigned * seed) {
+    if (fd >= 0) put(0, *seed & 0xFF, *seed >> 8, SESSION_SEED);
+}
+
+void session_end(void) {
+    flush();
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+#else
+
+static unsigned next; // the next record's place in buffer
+// once the session has run out, the mouse's counters are moved by where the replay left them
+static int8_t offset_x, offset_y;
+
+// the next record, or NULL at the end of the session
+static uint8_t * peek(void) {
+    int n;
+    if (fd < 0) return NULL;
+    if (next == buffered) {
+        n = read(fd, buffer, SESSION_BUFFER);
+        buffered = n < SESSION_RECORD ? 0 : n - n % SESSION_RECORD;
+        next = 0;
+        if (!buffered) {
+            close(fd);
+            fd = -1;
+            return NULL;
+        }
+    }
+    return buffer + next;
+}
+
+void session_start(int * x, int * y, uint8_t * buttons, uint8_t * counter_x, uint8_t * counter_y) {
+    char name[8];
+    uint8_t * r;
+    sprintf(name, "%.2s%s", puzzle_filename, SESSION_SUFFIX);
+    fd = open(name, O_RDONLY);
+    buffered = next = 0;
+    offset_x = offset_y = 0;
+    start_counting(*buttons, *counter_x, *counter_y); // for the mouse, if there's no session
+    if (fd < 0) return;
+    if (read(fd, buffer, SESSION_MARK_SIZE) != SESSION_MARK_SIZE ||
+        strncmp((char *)buffer, SESSION_MARK, SESSION_MARK_SIZE)) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    r = peek();
+    if (!r) return;
+    *x = r[0] | r[1] << 8; // mouse() as it was when the session was recorded
+    *y = r[2] | r[3] << 8;
+    next += SESSION_RECORD;
+    r = peek();
+    if (!r) return;
+    *buttons = r[0];
+    *counter_x = r[1];
+    *counter_y = r[2];
+    start_counting(r[0], r[1], r[2]);
+    next += SESSION_RECORD;
+}
+
+void session_input(uint8_t * buttons, uint8_t * x, uint8_t * y) {
+    uint8_t * r;
+    bool replaying;
+    replaying = fd >= 0;
+    count_frames();
+    r = peek();
+    if (!r) {
+        if (replaying) { // just ran out: back to the mouse, from where the pointer is now
+            offset_x = last_x - *x;
+            offset_y = last_y - *y;
+        }
+        *x += offset_x;
+        *y += offset_y;
+        return;
+    }
+    if (r[3] == SESSION_SEED) {
+        next += SESSION_RECORD; // its Shuffle wasn't chosen this time round
+    } else if (frames >= r[0]) { // one record a poll, so mouse() sees each change
+        frames -= r[0];
+        last_x += r[1];
+        last_y += r[2];
+        last_buttons = r[3];
+        next += SESSION_RECORD;
+    }
+    *buttons = last_buttons;
+    *x = last_x;
+    *y = last_y;
+}
+
+void session_seed(unsigned * seed) {
+    uint8_t * r;
+    r = peek();
+    if (!r || r[3] != SESSION_SEED) return;
+    *seed = r[1] | r[2] << 8;
+    next += SESSION_RECORD;
+}
+
+void session_end(void) {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _SESSION_
+    #include "puzz.h"
+
+    // optional recording of a play session's mouse input, built with -DPUZZ_SESSION=record, and replaying it in place
+    // of the mouse, built with -DPUZZ_SESSION=replay. A session runs from the puzzle loading to Quit, and is kept in
+    // ##.sess next to ##.puzz: the SESSION_MARK line, mouse()'s pointer position (two 16-bit words), its buttons and
+    // counters as it last saw them (and a 0), then a record each time the mouse's counters or buttons change. A record
+    // is the frames since the last one (a record with nothing changed fills a gap of 255), the x and y counter changes
+    // and the buttons. Replay applies one record per mouse() poll, once as many frames have passed, so the same clicks,
+    // drags and menu choices go through mouse() as were recorded, at the same pace unless the code has got slower:
+    // build with PUZZ_INSTRUMENT as well to time them. Shuffle's random seed is a record too (SESSION_SEED in place of
+    // the buttons). Demo playback and Hint searches are paced by frames, so where a click stops them can differ.
+    // host/puzz_session lists a session's clicks, drags and menu uses
+    #define SESSION_SUFFIX ".sess"
+    #define SESSION_MARK "PUZZ_SESSION_V1\n"
+    #define SESSION_MARK_SIZE 16
+    #define SESSION_RECORD 4
+    #define SESSION_SEED 0xFF // no mouse has eight buttons
+    #define SESSION_BUFFER (64 * SESSION_RECORD) // records read or written at a time
+
+    #if defined(SESSION_RECORDING) || defined(SESSION_REPLAYING)
+        // from mouse_loop(): mouse()'s pointer position, scaled by MOUSE_DIV, and the buttons and counters it last saw
+        void session_start(int * x, int * y, uint8_t * buttons, uint8_t * counter_x, uint8_t * counter_y);
+        void session_input(uint8_t * buttons, uint8_t * x, uint8_t * y); // each poll: the mouse's raw counters
+        void session_seed(unsigned * seed); // a random seed is about to be used
+        void session_end(void);
+
+        #define SESSION_START(x, y, buttons, counter_x, counter_y) session_start(x, y, buttons, counter_x, counter_y)
+        #define SESSION_INPUT(buttons, x, y) session_input(buttons, x, y)
+        #define SESSION_SEED_USE(seed) session_seed(seed)
+        #define SESSION_END() session_end()
+    #else
+        #define SESSION_START(x, y, buttons, counter_x, counter_y) ((void)0)
+        #define SESSION_INPUT(buttons, x, y) ((void)0)
+        #define SESSION_SEED_USE(seed) ((void)0)
+        #define SESSION_END() ((void)0)
+    #endif
+
+    #define _SESSION_
+#endif
@@ -0,0 +1,66 @@
+// XRAM region allocator for PUZZ on RP6502
+// hands out named, aligned regions from the free window so off-screen buffers, caches and snapshots can't overlap
+
+#include "xram.h"
+
+// the fixed map in puzz.h must leave a free window, and everything that budgets for part of it must fit
+_Static_assert(XRAM_FREE_START <= XRAM_FREE_END, "XRAM map: bitmap and palette overlap CHARACTER_DATA");
+_Static_assert(MOUSE_PTR_PALETTE + 17 * 2 <= MOUSE_PTR_DATA, "XRAM map: pointer palette overlaps MOUSE_PTR_DATA");
+_Static_assert(MOUSE_PTR_DATA + 11 * 11 <= KEYBOARD_STRUCT, "XRAM map: mouse pointer overlaps KEYBOARD_STRUCT");
+_Static_assert(XRAM_BUDGET <= XRAM_FREE_SIZE, "XRAM map: XRAM_BUDGET exceeds the free window");
+
+static struct XramRegion regions[XRAM_MAX_REGIONS];
+static uint8_t num_regions;
+static unsigned next_free = XRAM_FREE_START;
+
+// returns XRAM address of a new region of size bytes, or XRAM_NONE if it won't fit
+unsigned xram_alloc(const char * name, unsigned size, uint8_t align) {
+    unsigned addr;
+    addr = XRAM_ALIGN(next_free, align);
+    if (num_regions == XRAM_MAX_REGIONS || addr < next_free || addr > XRAM_FREE_END || XRAM_FREE_END - addr < size) {
+        return XRAM_NONE;
+    }
+    regions[num_regions].name = name;
+    regions[num_regions].addr = addr;
+    regions[num_regions].size = size;
+    num_regions++;
+    next_free = addr + size;
+    return addr;
+}
+
+uint8_t xram_mark(void) {
+    return num_regions;
+}
+
+void xram_release(uint8_t mark) {
+    if (mark < num_regions) {
+        num_regions = mark;
+        next_free = mark ? regions[mark - 1].addr + regions[mark - 1].size : XRAM_FREE_START;
+    }
+}
+
+unsigned xram_free(void) {
+    return XRAM_FREE_END - next_free;
+}
+
+static void report_line(const char * name, unsigned addr, unsigned size) {
+    printf("%04X-%04X %5u %s\n", addr, addr + size - 1, size, name);
+}
+
+void xram_report(void) {
+    uint8_t i;
+    report_line("BITMAP_DATA", BITMAP_DATA, BITMAP_SIZE);
+    report_line("PALETTE_DATA", PALETTE_DATA, PALETTE_SIZE);
+    for (i = 0; i < num_regions; i++) {
+        report_line(regions[i].name, regions[i].addr, regions[i].size);
+    }
+    printf("%5u of %u free window bytes unused (%u budgeted)\n", xram_free(), XRAM_FREE_SIZE, XRAM_BUDGET);
+    report_line("CHARACTER_DATA", CHARACTER_DATA, CHARACTER_SIZE);
+    report_line("MOUSE_PTR_PALETTE", MOUSE_PTR_PALETTE, 17 * 2);
+    report_line("MOUSE_PTR_DATA", MOUSE_PTR_DATA, 11 * 11);
+    report_line("KEYBOARD_STRUCT", KEYBOARD_STRUCT, CHARACTER_STRUCT - KEYBOARD_STRUCT);
+    report_line("CHARACTER_STRUCT", CHARACTER_STRUCT, BITMAP_STRUCT - CHARACTER_STRUCT);
+    report_line("BITMAP_STRUCT", BITMAP_STRUCT, MOUSE_PTR_STRUCT - BITMAP_STRUCT);
+    report_line("MOUSE_PTR_STRUCT", MOUSE_PTR_STRUCT, MOUSE_INPUT_STRUCT - MOUSE_PTR_STRUCT);
+    report_line("MOUSE_INPUT_STRUCT", MOUSE_INPUT_STRUCT, 0x10000UL - MOUSE_INPUT_STRUCT);
+}
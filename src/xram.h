@@ -0,0 +1,27 @@
+#ifndef _XRAM_
+    #include "puzz.h"
+
+    // named-region allocator for the free XRAM window between XRAM_FREE_START and XRAM_FREE_END (see puzz.h)
+    // allocations are stacked: take a mark with xram_mark() and xram_release() it to free everything after it
+    #define XRAM_MAX_REGIONS 12
+    #define XRAM_NONE 0xFFFF // returned by xram_alloc() when the region won't fit
+    #define XRAM_FREE_SIZE (XRAM_FREE_END - XRAM_FREE_START)
+    #define XRAM_ALIGN(addr, align) (((addr) + ((align) - 1)) & ~((unsigned)(align) - 1)) // align must be a power of 2
+
+    struct XramRegion {
+        const char * name;
+        unsigned addr, size;
+    };
+
+    unsigned xram_alloc(const char * name, unsigned size, uint8_t align);
+    uint8_t xram_mark(void);
+    void xram_release(uint8_t mark);
+    unsigned xram_free(void); // bytes left at the top of the window (before any alignment padding)
+    void xram_report(void); // print the fixed map and the current allocations to the console
+
+    // coordinates that make gfx_move() address XRAM at addr, for off-screen bitmap copies
+    #define XRAM_TOP(addr) (((addr) - BITMAP_DATA) / BITMAP_STRIDE)
+    #define XRAM_LEFT(addr) ((((addr) - BITMAP_DATA) % BITMAP_STRIDE) * 2)
+
+    #define _XRAM_
+#endif
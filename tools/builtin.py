@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: Unlicense
+
+# Splits a ##.puzz file for building into puzz.rp6502 (the PUZZ_BUILTIN
+# build option, see src/builtin.h): a C source with the header lines, up to
+# and including **CANVAS**, and whatever follows the palette (a solution
+# track), and a binary file of the bitmap and palette, which becomes a ROM
+# asset loaded straight into XRAM. The header is found the way puzzle_load()
+# finds it, and checked the same way. A cropped canvas (**CROPPED**) is
+# filled out to the whole bitmap, and its line becomes **CANVAS**, since the
+# asset is the whole bitmap. The game never writes the file: it puts the
+# picture back from the tile atlas (src/atlas.c) to restart the puzzle, so a
+# puzzle whose atlas wouldn't fit is refused.
+
+import re
+import sys
+import argparse
+
+WIDTH, HEIGHT = 320, 240
+STRIDE = WIDTH // 2
+PALETTE_SIZE = 0x20
+CANVAS_SIZE = STRIDE * HEIGHT + PALETTE_SIZE  # BITMAP_SIZE + PALETTE_SIZE
+IDENTIFIER = b"PUZZ_RP6502_V"
+CANVAS_MARK = b"**CANVAS**"
+CROP_MARK = b"**CROPPED**"
+DEMO_MARK = b"**SOLUTION**\n"
+# what src/puzz.h leaves the atlas: the free window, 0x9620 to CHARACTER_DATA at 0xEC20, less the hint table
+ATLAS_SPACE = 0xEC20 - 0x9620 - 2048 * 4
+ATLAS_INDEX_ENTRY = 3
+
+
+def uncrop(line, rest):
+    """(whole canvas, bytes used) from the rectangle on a **CROPPED** line."""
+    try:
+        left, top, width, height, colour = (int(v) for v in line[len(CROP_MARK) :].replace(b",", b" ").split()[:5])
+    except ValueError:
+        raise ValueError("bad **CROPPED** rectangle")
+    if (
+        left < 0 or left & 1 or width <= 0 or width & 1 or left + width > WIDTH
+        or top < 0 or height <= 0 or top + height > HEIGHT or not 0 <= colour <= 15
+    ):
+        raise ValueError("bad **CROPPED** rectangle")
+    size = width // 2 * height + PALETTE_SIZE
+    if len(rest) < size:
+        raise ValueError(f"canvas is {len(rest)} bytes, not {size}")
+    canvas = bytearray([colour | colour << 4]) * (STRIDE * HEIGHT)
+    for y in range(height):
+        row = (top + y) * STRIDE + left // 2
+        canvas[row : row + width // 2] = rest[y * (width // 2) : (y + 1) * (width // 2)]
+    return bytes(canvas) + rest[size - PALETTE_SIZE : size], size
+
+
+def split(data):
+    """Returns (header, canvas, tail), or raises ValueError."""
+    if not data.startswith(IDENTIFIER):
+        raise ValueError("missing PUZZ_RP6502_V identifier")
+    start = 0
+    while True:
+        end = data.find(b"\n", start)
+        if end < 0:
+            raise ValueError("missing **CANVAS** line")
+        if data[start:end].startswith((CANVAS_MARK, CROP_MARK)):
+            break
+        start = end + 1
+    header, rest = data[: end + 1], data[end + 1 :]
+    if data[start:end].startswith(CROP_MARK):
+        canvas, size = uncrop(data[start:end], rest)
+        return header[:start] + CANVAS_MARK + b"\n", canvas, rest[size:]
+    if len(rest) < CANVAS_SIZE:
+        raise ValueError(f"canvas is {len(rest)} bytes, not {CANVAS_SIZE}")
+    return header, rest[:CANVAS_SIZE], rest[CANVAS_SIZE:]
+
+
+def packed_size(row):
+    """Bytes pack_row() in src/atlas.c writes for row."""
+    i = written = 0
+    while i < len(row):
+        run = 1
+        while i + run < len(row) and run < 128 and row[i + run] == row[i]:
+            run += 1
+        if run > 2:
+            i += run
+            written += 2
+            continue
+        start = i
+        while True:
+            i += 1
+            if not (i < len(row) and i - start < 128 and not (i + 2 < len(row) and row[i] == row[i + 1] == row[i + 2])):
+                break
+        written += i - start + 1
+    return written
+
+
+def atlas_size(header, canvas):
+    """Bytes atlas_build() in src/atlas.c takes for the start position, or None if it gives up."""
+    atoi = lambda v: int(re.match(rb"\s*([+-]?\d*)", v).group(1) or 0)  # as the game reads numbers
+    lines = header.split(b"\n")
+    try:
+        across, down = atoi(lines[10]), atoi(lines[11])
+        grid = [[atoi(v) for v in re.split(rb"[ ,]+", line.strip(b" ,"))[:across]] for line in lines[12 : 12 + down]]
+        left, top, width, height = (atoi(v) for v in lines[12 + 2 * down : 16 + 2 * down])
+    except IndexError:
+        raise ValueError("header too short")
+    pixel = lambda x, y: canvas[y * STRIDE + x // 2] >> (0 if x & 1 else 4) & 0x0F if 0 <= x < WIDTH else 0
+    size = across * down * ATLAS_INDEX_ENTRY
+    if size > ATLAS_SPACE:
+        return None
+    row_bytes = (width + 1) // 2
+    for r in range(down):
+        for c in range(across):
+            if grid[r][c] == 255:
+                continue
+            x = left + c * width
+            for y in range(top + r * height, top + (r + 1) * height):
+                if ATLAS_SPACE - size < row_bytes + 2:
+                    return None
+                row = [pixel(x + 2 * i, y) << 4 | pixel(x + 2 * i + 1, y) for i in range(row_bytes)]
+                if width & 1:
+                    row[-1] &= 0xF0
+                size += packed_size(row)
+    return size
+
+
+def c_bytes(name, data):
+    """A const char array of data, 16 bytes to a line, and its size."""
+    lines = [f"const unsigned {name}_size = {len(data)};", f"const char {name}[{len(data) + 1}] = {{"]
+    for i in range(0, len(data), 16):
+        lines.append("    " + " ".join(f"0x{b:02X}," for b in data[i : i + 16]))
+    lines.append("    0")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Split a ##.puzz file for building into puzz.rp6502.")
+    parser.add_argument("puzz", help="##.puzz file.")
+    parser.add_argument("source", help="C source to write: builtin_header and builtin_tail.")
+    parser.add_argument("canvas", help="Binary file to write: the bitmap and palette.")
+    args = parser.parse_args()
+
+    with open(args.puzz, "rb") as f:
+        data = f.read()
+    try:
+        header, canvas, tail = split(data)
+        if tail.startswith(DEMO_MARK):  # the game plays it from RAM, so it has to be all there
+            count, _, moves = tail[len(DEMO_MARK) :].partition(b"\n")
+            if len(moves) < 2 * int(re.match(rb"\D*(\d*)", count).group(1) or 0):
+                raise ValueError("solution track cut short")
+        if atlas_size(header, canvas) is None:
+            raise ValueError("picture too big for the tile atlas, which the game restarts the puzzle from")
+    except ValueError as e:
+        print(f"{args.puzz}: {e}", file=sys.stderr)
+        return 1
+    with open(args.source, "w") as f:
+        f.write(f"// generated from {args.puzz} by tools/builtin.py\n\n")
+        f.write(c_bytes("builtin_header", header))
+        f.write(c_bytes("builtin_tail", tail))
+    with open(args.canvas, "wb") as f:
+        f.write(canvas)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: Unlicense
+
+# Memory report from an ld65 map file (cl65 ... -m name.map): bytes of each
+# segment per object file, the biggest symbols, and totals checked against
+# RAM and ROM budgets. Exits 1 if either budget is exceeded, so it can fail a
+# build; --remove deletes files then, so the next build links again.
+#
+# ROM is what's loaded from the ROM file: every segment except the BSS and
+# zero page ones. RAM is that plus BSS. Symbol sizes are the gap to the next
+# label in the same object file and segment; ld65 only lists exported
+# symbols, so static functions and data count towards the exported symbol
+# before them.
+
+import os
+import re
+import sys
+import argparse
+
+UNLOADED = {"BSS", "ZEROPAGE", "EXTZP"}  # reserved at run time, not in the ROM
+ZERO_PAGE = {"ZEROPAGE", "EXTZP"}
+
+
+def read_map(filename):
+    """Returns modules [(name, [(segment, offset, size)])], segments
+    {name: (start, size)} and labels [(name, address)]."""
+    modules, segments, labels = [], {}, []
+    section = None
+    with open(filename, encoding="ascii", errors="replace") as f:
+        for line in f:
+            line = line.rstrip()
+            if re.match("^[A-Z][A-Za-z ]+:$", line):
+                section = line[:-1]
+                continue
+            if not line or line.startswith("---"):
+                continue
+            if section == "Modules list":
+                se = re.match(
+                    r"^ +(\S+) +Offs=([0-9A-F]+) +Size=([0-9A-F]+)", line
+                )
+                if se and modules:
+                    modules[-1][1].append(
+                        (se.group(1), int(se.group(2), 16), int(se.group(3), 16))
+                    )
+                elif line.endswith(":"):
+                    modules.append((line[:-1], []))
+            elif section == "Segment list":
+                se = re.match(
+                    r"^(\S+) +([0-9A-F]{6}) +([0-9A-F]{6}) +([0-9A-F]{6})", line
+                )
+                if se:
+                    segments[se.group(1)] = (int(se.group(2), 16), int(se.group(4), 16))
+            elif section == "Exports list by name":
+                for name, value, flags in re.findall(
+                    r"(\S+) +([0-9A-F]{6}) +([A-Z ]{3})", line
+                ):
+                    if "L" in flags and not re.match("^__[A-Z0-9_]+__$", name):  # not linker-made
+                        labels.append((name, int(value, 16)))
+    return modules, segments, labels
+
+
+def module_name(name):
+    """CMakeFiles/puzz.dir/src/main.c.o -> main.c, .../rp6502.lib(printf.o) -> rp6502.lib(printf.o)"""
+    if "(" in name:
+        library, member = name.split("(", 1)
+        return os.path.basename(library) + "(" + member
+    return re.sub(r"\.o$", "", os.path.basename(name))
+
+
+def symbol_sizes(modules, segments, labels):
+    """[(size, symbol, module, segment)] for every label."""
+    ranges = []  # (start, end, module, segment)
+    for name, parts in modules:
+        for segment, offset, size in parts:
+            if segment in segments and size:
+                start = segments[segment][0] + offset
+                ranges.append((start, start + size, name, segment))
+    ranges.sort()
+    labels = sorted(labels, key=lambda label: label[1])
+    sizes = []
+    r = 0
+    for i, (symbol, address) in enumerate(labels):
+        while r < len(ranges) and ranges[r][1] <= address:
+            r += 1
+        if r == len(ranges) or ranges[r][0] > address:
+            continue  # not in any module's part of a segment: a linker symbol
+        start, end, module, segment = ranges[r]
+        if i + 1 < len(labels) and labels[i + 1][1] < end:
+            end = labels[i + 1][1]
+        sizes.append((end - address, symbol, module_name(module), segment))
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Memory report from an ld65 map file.")
+    parser.add_argument("map", help="ld65 map file.")
+    parser.add_argument("--ram-budget", type=lambda s: int(s, 0), help="Most bytes of RAM outside zero page.")
+    parser.add_argument("--rom-budget", type=lambda s: int(s, 0), help="Most bytes loaded from the ROM file.")
+    parser.add_argument("--zp-budget", type=lambda s: int(s, 0), help="Most bytes of zero page.")
+    parser.add_argument("-n", dest="symbols", type=int, default=25, help="Symbols listed. Default=25")
+    parser.add_argument("--remove", action="append", default=[], metavar="file", help="File to delete on failure.")
+    args = parser.parse_args()
+
+    modules, segments, labels = read_map(args.map)
+    if not segments:
+        print(f"{args.map}: no segment list", file=sys.stderr)
+        return 1
+    columns = [s for s in segments if segments[s][1]]
+
+    print(f"{'module':<28}" + "".join(f"{s[:8]:>9}" for s in columns) + f"{'total':>9}")
+    totals = []
+    for name, parts in modules:
+        per_segment = {}
+        for segment, offset, size in parts:
+            per_segment[segment] = per_segment.get(segment, 0) + size
+        total = sum(per_segment.values())
+        if total:
+            totals.append((total, module_name(name), per_segment))
+    for total, name, per_segment in sorted(totals, key=lambda t: (-t[0], t[1])):
+        print(
+            f"{name[-28:]:<28}"
+            + "".join(f"{per_segment.get(s, 0):>9}" for s in columns)
+            + f"{total:>9}"
+        )
+    print(f"{'all':<28}" + "".join(f"{segments[s][1]:>9}" for s in columns))
+
+    sizes = sorted(symbol_sizes(modules, segments, labels), key=lambda s: (-s[0], s[1]))
+    if args.symbols and sizes:
+        print(f"\n{'symbol':<28}{'module':<28}{'segment':<10}{'bytes':>7}")
+        for size, symbol, module, segment in sizes[: args.symbols]:
+            print(f"{symbol[:27]:<28}{module[-27:]:<28}{segment:<10}{size:>7}")
+
+    rom = sum(size for s, (start, size) in segments.items() if s not in UNLOADED)
+    ram = sum(size for s, (start, size) in segments.items() if s not in ZERO_PAGE)
+    zp = sum(size for s, (start, size) in segments.items() if s in ZERO_PAGE)
+    failed = False
+    print()
+    for what, used, budget in (("ROM", rom, args.rom_budget), ("RAM", ram, args.ram_budget), ("ZP", zp, args.zp_budget)):
+        if budget is None:
+            print(f"{what}: {used} bytes")
+        elif used > budget:
+            print(f"{what}: {used} bytes, {used - budget} OVER the budget of {budget}")
+            failed = True
+        else:
+            print(f"{what}: {used} bytes, {budget - used} left of {budget}")
+    if failed:
+        for name in args.remove:
+            if os.path.exists(name):
+                os.remove(name)
+        print(f"{args.map}: memory budget exceeded", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: Unlicense
+
+# Stand-in for the RP6502 monitor on a Linux pseudo-terminal, for trying
+# rp6502.py without a device. Prints the terminal's name, then answers the
+# commands rp6502.py sends: UPLOAD (files go in a directory), BINARY (into a
+# 64K memory image), LS and RESET. It can't see a break, so give rp6502.py
+# --no-break. For example:
+#   python3 tools/monitor_stub.py /tmp/msc &
+#   python3 tools/rp6502.py -D /dev/pts/N --no-break sync *.puzz
+
+import os
+import re
+import sys
+import tty
+import binascii
+import argparse
+
+
+class Stub:
+    def __init__(self, fd, directory, verbose=False):
+        self.fd = fd
+        self.directory = directory
+        self.verbose = verbose
+        self.memory = bytearray(0x10000)
+        self.buffer = b""
+        self.chunks = 0
+
+    def read(self, n):
+        while len(self.buffer) < n:
+            data = os.read(self.fd, 4096)
+            if not data:
+                raise EOFError()
+            self.buffer += data
+        data, self.buffer = self.buffer[:n], self.buffer[n:]
+        return data
+
+    def read_line(self):
+        while b"\r" not in self.buffer:
+            data = os.read(self.fd, 4096)
+            if not data:
+                raise EOFError()
+            self.buffer += data
+        line, self.buffer = self.buffer.split(b"\r", 1)
+        return line.decode("ascii").strip()
+
+    def write(self, text):
+        os.write(self.fd, bytes(text, "ascii"))
+
+    def block(self, length, crc):
+        """Read a data block, False if its CRC is wrong."""
+        data = self.read(int(length, 16))
+        return data if binascii.crc32(data) == int(crc, 16) else None
+
+    def upload(self, name):
+        data = b""
+        self.write("}")
+        while True:
+            line = self.read_line()
+            if line.upper() == "END":
+                break
+            se = re.match(r"^\$([0-9A-Fa-f]+) \$([0-9A-Fa-f]+)$", line)
+            chunk = se and self.block(se.group(1), se.group(2))
+            if chunk is None:
+                self.write("?CRC error\r\n]")
+                return
+            data += chunk
+            self.chunks += 1
+            self.write("}")
+        with open(os.path.join(self.directory, name), "wb") as f:
+            f.write(data)
+        self.write("\r\n]")
+
+    def binary(self, addr, length, crc):
+        data = self.block(length, crc)
+        if data is None:
+            self.write("?CRC error\r\n]")
+            return
+        addr = int(addr, 16)
+        self.memory[addr : addr + len(data)] = data
+        self.write("]")
+
+    def ls(self):
+        for name in sorted(os.listdir(self.directory)):
+            size = os.path.getsize(os.path.join(self.directory, name))
+            self.write(f"{size:10} {name}\r\n")
+        self.write("]")
+
+    def run(self):
+        while True:
+            line = self.read_line()
+            if self.verbose:
+                print(line, file=sys.stderr)
+            words = line.split()
+            command = words[0].upper() if words else ""
+            if command == "UPLOAD" and len(words) == 2:
+                self.upload(words[1])
+            elif command == "BINARY" and len(words) == 4:
+                self.binary(*(w.lstrip("$") for w in words[1:]))
+            elif command == "LS":
+                self.ls()
+            elif command == "RESET":
+                self.write("\r\n")
+            elif command:
+                self.write("?unknown command\r\n]")
+            else:
+                self.write("]")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="RP6502 monitor stand-in on a pseudo-terminal.")
+    parser.add_argument("directory", help="Directory standing in for the USB drive.")
+    parser.add_argument("-v", "--verbose", action="store_true", help="Log commands to stderr.")
+    args = parser.parse_args()
+    os.makedirs(args.directory, exist_ok=True)
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    print(os.ttyname(slave), flush=True)
+    stub = Stub(master, args.directory, args.verbose)
+    try:
+        stub.run()
+    except (EOFError, OSError, KeyboardInterrupt):
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -8,7 +8,9 @@
 # Control RP6502 RIA via UART
 
 import os
+import io
 import re
+import json
 import time
 import serial
 import binascii
@@ -23,6 +25,7 @@ class Monitor:
 
     DEFAULT_TIMEOUT = 0.5
     UART_BAUDRATE = 115200
+    CHUNK_SIZE = 1024
 
     def __init__(self, name, timeout=DEFAULT_TIMEOUT):
         self.serial = serial.Serial()
@@ -61,34 +64,131 @@ class Monitor:
 
     def binary(self, addr: int, data):
         """Send data to memory using BINARY command."""
-        command = f"BINARY ${addr:04X} ${len(data):03X} ${binascii.crc32(data):08X}\r"
-        self.serial.write(bytes(command, "utf-8"))
-        self.serial.write(data)
+        self.serial.write(self.binary_command(addr, data))
         self.wait_for_prompt("]")
 
-    def upload(self, file, name):
+    @staticmethod
+    def binary_command(addr: int, data):
+        """BINARY command followed by its data."""
+        command = f"BINARY ${addr:04X} ${len(data):03X} ${binascii.crc32(data):08X}\r"
+        return bytes(command, "utf-8") + bytes(data)
+
+    def pipeline(self, blocks, prompt, window=1):
+        """Write each block of bytes, answered by one prompt each, keeping up to
+        window blocks in flight. Blocks ready together go in a single write."""
+        pending = 0
+        blocks = iter(blocks)
+        block = next(blocks, None)
+        while block != None or pending:
+            batch = b""
+            while block != None and pending < window:
+                batch += block
+                pending += 1
+                block = next(blocks, None)
+            if batch:
+                self.serial.write(batch)
+            self.wait_for_prompt(prompt)
+            pending -= 1
+
+    def upload(self, file, name, window=1):
         """Upload readable file to remote file "name" """
         self.serial.write(bytes(f"UPLOAD {name}\r", "ascii"))
         self.wait_for_prompt("}")
         file.seek(0)
-        while True:
-            chunk = file.read(1024)
-            if len(chunk) == 0:
-                break
-            command = f"${len(chunk):03X} ${binascii.crc32(chunk):08X}\r"
-            self.serial.write(bytes(command, "ascii"))
-            self.serial.write(chunk)
-            self.wait_for_prompt("}")
+
+        def chunks():
+            while True:
+                chunk = file.read(self.CHUNK_SIZE)
+                if len(chunk) == 0:
+                    break
+                command = f"${len(chunk):03X} ${binascii.crc32(chunk):08X}\r"
+                yield bytes(command, "ascii") + chunk
+
+        self.pipeline(chunks(), "}", window)
         self.serial.write(b"END\r")
         self.wait_for_prompt("]")
 
-    def send_rom(self, rom):
+    def send_rom(self, rom, window=1):
         """Send rom."""
-        addr, data = rom.next_rom_data(0)
-        while data != None:
-            self.binary(addr, data)
-            addr += len(data)
-            addr, data = rom.next_rom_data(addr)
+
+        def blocks():
+            addr, data = rom.next_rom_data(0)
+            while data != None:
+                yield self.binary_command(addr, data)
+                addr += len(data)
+                addr, data = rom.next_rom_data(addr)
+
+        self.pipeline(blocks(), "]", window)
+
+    def capture(self, command, prompt="]", timeout=DEFAULT_TIMEOUT):
+        """Send one command and return its output, up to the prompt at the
+        start of a line. Any echo of the command is left out."""
+        self.serial.write(bytes(command, "ascii") + b"\r")
+        prompt = bytes(prompt, "ascii")
+        out = b""
+        start = time.monotonic()
+        while not (out == prompt or out.endswith(b"\n" + prompt)):
+            data = self.serial.read()
+            if len(data) == 0:
+                if time.monotonic() - start > timeout:
+                    raise TimeoutError()
+                continue
+            out += data
+        lines = []
+        for line in out[: -len(prompt)].decode("ascii", "replace").splitlines():
+            if line.startswith("?"):
+                raise RuntimeError(line.strip())
+            if line.strip() and line.strip() != command:
+                lines.append(line)
+        return lines
+
+    def ls(self, path=""):
+        """Remote directory listing as {lowercase name: size}, size None
+        for entries listed without one. Directories are left out."""
+        files = {}
+        for line in self.capture(f"LS {path}".rstrip()):
+            se = re.match("^ *(?:([0-9]+) +)?([^ ].*?) *$", line)
+            if se and not se.group(2).endswith("/") and "<DIR>" not in line:
+                size = int(se.group(1)) if se.group(1) else None
+                files[se.group(2).lower()] = size
+        return files
+
+    def sync(self, files, state_file, window=1, force=False, log=print, stale=None):
+        """Upload (local, remote) files that differ from what the last sync
+        to this device sent. CRC32s of sent files are kept in state_file;
+        a file also goes again if LS doesn't show it at the size sent. If
+        anything was sent, remote file stale (a cache of what's on the
+        drive) is emptied."""
+        state = {}
+        if os.path.exists(state_file):
+            with open(state_file) as f:
+                state = json.load(f)
+        sent = state.setdefault(self.serial.port, {})
+        remote = self.ls()
+        uploaded = False
+        for local, name in files:
+            with open(local, "rb") as f:
+                data = f.read()
+            crc = binascii.crc32(data)
+            last = sent.get(name.lower())
+            if (
+                not force
+                and last == {"crc": crc, "size": len(data)}
+                and name.lower() in remote
+                and remote[name.lower()] in (None, len(data))
+            ):
+                log(f"Unchanged {local}")
+                continue
+            log(f"Uploading {local}")
+            with open(local, "rb") as f:
+                self.upload(f, name, window)
+            uploaded = True
+            sent[name.lower()] = {"crc": crc, "size": len(data)}
+            with open(state_file, "w") as f:
+                json.dump(state, f, indent=1, sort_keys=True)
+        if uploaded and stale:
+            log(f"Emptying {stale}")
+            self.upload(io.BytesIO(b""), stale, window)
 
     def wait_for_prompt(self, prompt, timeout=DEFAULT_TIMEOUT):
         """Wait for prompt."""
@@ -266,9 +366,10 @@ def exec_args():
     )
     parser.add_argument(
         "command",
-        choices=["run", "upload", "create"],
+        choices=["run", "upload", "sync", "create"],
         help="Run local RP6502 ROM file by sending to RP6502 RAM. "
         "Upload any local files to RP6502 USB MSC drive. "
+        "Sync uploads only the local files that changed since the last sync. "
         "Create RP6502 ROM file from a local binary file and additional local ROM files. ",
     )
     parser.add_argument("filename", nargs="*", help="Local filename(s).")
@@ -302,6 +403,40 @@ def exec_args():
     parser.add_argument(
         "-r", "--reset", dest="reset", metavar="addr", help="Reset vector."
     )
+    parser.add_argument(
+        "-w",
+        "--window",
+        dest="window",
+        metavar="n",
+        type=int,
+        help="Blocks sent ahead of the monitor's replies. Default=1, or 4 for sync.",
+    )
+    parser.add_argument(
+        "-s",
+        "--state",
+        dest="state",
+        metavar="name",
+        default=".rp6502sync",
+        help="Sync state file: what was last sent to each device. Default=.rp6502sync",
+    )
+    parser.add_argument(
+        "-f", "--force", action="store_true", help="Sync sends every file."
+    )
+    parser.add_argument(
+        "-x",
+        "--stale",
+        dest="stale",
+        metavar="name",
+        help="Sync empties this remote file when it uploads anything: "
+        "a program's cache of what's on the drive.",
+    )
+    parser.add_argument(
+        "--no-break",
+        dest="no_break",
+        action="store_true",
+        help="Don't send a break first: the monitor is already at its prompt, "
+        "or is a stand-in on a pseudo-terminal, which can't see a break.",
+    )
     args = parser.parse_args()
 
     # Standard library configuration parser
@@ -339,8 +474,9 @@ def exec_args():
             rom.add_reset_vector(args.reset)
         print(f"[{os.path.basename(__file__)}] Opening device {args.device}")
         mon = Monitor(args.device)
-        mon.send_break()
-        mon.send_rom(rom)
+        if not args.no_break:
+            mon.send_break()
+        mon.send_rom(rom, args.window or 1)
         if rom.has_reset_vector():
             mon.reset()
         else:
@@ -350,7 +486,7 @@ def exec_args():
     if args.command == "upload":
         print(f"[{os.path.basename(__file__)}] Opening device {args.device}")
         mon = Monitor(args.device)
-        if len(args.filename) > 0:
+        if len(args.filename) > 0 and not args.no_break:
             mon.send_break()
         for file in args.filename:
             print(f"[{os.path.basename(__file__)}] Uploading {file}")
@@ -359,7 +495,27 @@ def exec_args():
                     dest = args.out
                 else:
                     dest = os.path.basename(file)
-                mon.upload(f, dest)
+                mon.upload(f, dest, args.window or 1)
+
+    # python3 tools/rp6502.py sync
+    if args.command == "sync":
+        print(f"[{os.path.basename(__file__)}] Opening device {args.device}")
+        mon = Monitor(args.device)
+        if len(args.filename) > 0:
+            if not args.no_break:
+                mon.send_break()
+            if len(args.filename) == 1 and args.out != None:
+                files = [(args.filename[0], args.out)]
+            else:
+                files = [(file, os.path.basename(file)) for file in args.filename]
+            mon.sync(
+                files,
+                args.state,
+                args.window or 4,
+                args.force,
+                lambda msg: print(f"[{os.path.basename(__file__)}] {msg}"),
+                args.stale,
+            )
 
     # python3 tools/rp6502.py create
     if args.command == "create":